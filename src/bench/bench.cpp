@@ -0,0 +1,228 @@
+#include "../sources/interpreter.hpp"
+#include "../sources/scanner.hpp"
+#include "../sources/parser.hpp"
+#include "../sources/vm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace halo;
+
+// runs every benchmark script a number of times in each mode and prints
+// the wall time, the allocations and the collections of the runs as JSON
+//
+// every run gets a fresh interpreter, the garbage of the previous runs is collected before it starts
+// and the heap size that starts a major collection, which only ever grows, is reset,
+// so the runs of a script allocate and collect the same way
+
+namespace
+{
+    const vector<string> default_scripts = {"fib", "loops", "strings", "list", "objects", "lambdas", "gc"};
+
+    const size_t heap_size = GC::instance().get_treshold();
+
+    struct Run
+    {
+        double m_ms = 0;
+        size_t m_allocations = 0;
+        size_t m_minor_collections = 0;
+        size_t m_major_collections = 0;
+        double m_pause_ms = 0;
+        string m_output;
+    };
+
+    size_t allocated_objects(const GCStats &stats)
+    {
+        size_t res = 0;
+
+        for (auto n : stats.m_allocated_objects)
+        {
+            res += n;
+        }
+
+        return res;
+    }
+
+    Run run_script(const string &src, bool use_vm)
+    {
+        Run res;
+        istringstream in("");
+        ostringstream out;
+
+        Interpreter interp(in, out);
+        GC::instance().collect();
+        GC::instance().set_heap_size(heap_size);
+
+        GCStats before = GC::instance().get_stats();
+        auto start = chrono::steady_clock::now();
+
+        Scanner scanner(src);
+        auto tokens = scanner.scan();
+        Parser parser(tokens);
+        parser.parse();
+
+        if (use_vm)
+        {
+            VM vm(interp);
+            vm.execute(parser.statements());
+        }
+        else
+        {
+            interp.execute(parser.statements());
+        }
+
+        auto end = chrono::steady_clock::now();
+        const GCStats &after = GC::instance().get_stats();
+
+        res.m_ms = chrono::duration<double, milli>(end - start).count();
+        res.m_allocations = allocated_objects(after) - allocated_objects(before);
+        res.m_minor_collections = after.m_minor_collections - before.m_minor_collections;
+        res.m_major_collections = after.m_major_collections - before.m_major_collections;
+        res.m_pause_ms = after.m_total_pause - before.m_total_pause;
+        res.m_output = out.str();
+
+        return res;
+    }
+
+    // the nearest rank percentile of sorted times
+    double percentile(const vector<double> &times, double p)
+    {
+        size_t rank = size_t(ceil(p / 100 * times.size()));
+        return times[rank ? rank - 1 : 0];
+    }
+
+    string json_string(const string &s)
+    {
+        string res = "\"";
+
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                res += '\\';
+            }
+
+            res += c;
+        }
+
+        return res + "\"";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    vector<string> args(argv + 1, argv + argc);
+    size_t runs = 5;
+    vector<bool> modes = {false, true};
+    vector<string> scripts;
+
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--runs" && i + 1 < args.size())
+        {
+            runs = max(1, stoi(args[++i]));
+        }
+        else if (args[i] == "--mode" && i + 1 < args.size() && (args[i + 1] == "interpreter" || args[i + 1] == "vm"))
+        {
+            modes = {args[++i] == "vm"};
+        }
+        else if (args[i].rfind("--", 0) == 0)
+        {
+            cerr << "Usage:\n    halo-bench [--runs n] [--mode interpreter|vm] [script.halo ...]\n"
+                 << "    runs the given scripts, or those of the suite in scripts/, n times (5 by default)\n"
+                 << "    in the given mode or in both, and prints the results as JSON" << endl;
+            return 1;
+        }
+        else
+        {
+            scripts.push_back(args[i]);
+        }
+    }
+
+    if (scripts.empty())
+    {
+        for (const auto &name : default_scripts)
+        {
+            scripts.push_back("scripts/" + name + ".halo");
+        }
+    }
+
+    cout << "{\n  \"runs\": " << runs << ",\n  \"compiler\": " << json_string(__VERSION__) << ",\n  \"benchmarks\": [";
+
+    bool first = true;
+    int status = 0;
+
+    for (const auto &path : scripts)
+    {
+        ifstream file(path);
+
+        if (!file)
+        {
+            cerr << "The file was not found: " << path << endl;
+            status = 1;
+            continue;
+        }
+
+        string src((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        string name = path.substr(path.find_last_of('/') + 1);
+        name = name.substr(0, name.rfind(".halo"));
+
+        string expected_output;
+
+        for (bool use_vm : modes)
+        {
+            vector<double> times;
+            Run last;
+
+            try
+            {
+                for (size_t i = 0; i < runs; ++i)
+                {
+                    last = run_script(src, use_vm);
+                    times.push_back(last.m_ms);
+
+                    // a benchmark that computes something else in some runs or modes measures nothing
+                    if (expected_output.empty())
+                    {
+                        expected_output = last.m_output;
+                    }
+                    else if (last.m_output != expected_output)
+                    {
+                        throw runtime_error("the output differs between the runs");
+                    }
+                }
+            }
+            catch (const exception &e)
+            {
+                cerr << name << ": " << e.what() << endl;
+                status = 1;
+                continue;
+            }
+
+            sort(times.begin(), times.end());
+
+            cout << (first ? "\n" : ",\n")
+                 << "    {\"name\": " << json_string(name)
+                 << ", \"mode\": \"" << (use_vm ? "vm" : "interpreter") << "\""
+                 << ", \"median_ms\": " << percentile(times, 50)
+                 << ", \"p95_ms\": " << percentile(times, 95)
+                 << ", \"min_ms\": " << times.front()
+                 << ", \"allocations\": " << last.m_allocations
+                 << ", \"minor_collections\": " << last.m_minor_collections
+                 << ", \"major_collections\": " << last.m_major_collections
+                 << ", \"gc_pause_ms\": " << last.m_pause_ms << "}";
+            first = false;
+        }
+    }
+
+    cout << (first ? "" : "\n  ") << "]\n}" << endl;
+
+    return status;
+}
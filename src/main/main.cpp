@@ -5,6 +5,9 @@
 #include "../sources/interpreter.hpp"
 #include "../sources/scanner.hpp"
 #include "../sources/parser.hpp"
+#include "../sources/vm.hpp"
+#include "../sources/profiler.hpp"
+#include "../sources/counters.hpp"
 
 using namespace std;
 using namespace halo;
@@ -14,27 +17,139 @@ void run_script(const string &s);
 string copy_file(ifstream &f);
 
 Interpreter interpreter;
+unique_ptr<VM> vm;
 vector<unique_ptr<Parser>> parsers;
 
 int main(int argc, char *argv[])
 {
-    if (argc == 1)
+    vector<string> args(argv + 1, argv + argc);
+    bool gc_stats = false;
+    unique_ptr<Profiler> profiler;
+    string folded_file = "halo.folded";
+    bool count = false;
+    string counters_file = "halo.info";
+
+    while (!args.empty() && (args[0] == "--vm" || args[0] == "--gc-stats" || args[0].rfind("--profile", 0) == 0 || args[0].rfind("--counters", 0) == 0))
+    {
+        if (args[0] == "--vm")
+        {
+            vm = make_unique<VM>(interpreter);
+        }
+        else if (args[0] == "--gc-stats")
+        {
+            gc_stats = true;
+        }
+        else if (args[0] == "--profile" || args[0].rfind("--profile=", 0) == 0)
+        {
+            profiler = make_unique<Profiler>();
+
+            if (args[0] != "--profile")
+            {
+                folded_file = args[0].substr(10);
+            }
+        }
+        else if (args[0] == "--counters" || args[0].rfind("--counters=", 0) == 0)
+        {
+            count = true;
+
+            if (args[0] != "--counters")
+            {
+                counters_file = args[0].substr(11);
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        args.erase(args.begin());
+    }
+
+    unique_ptr<Counters> counters;
+
+    if (count && args.size() <= 1)
+    {
+        counters = make_unique<Counters>(args.empty() ? "" : args[0]);
+        interpreter.set_counters(counters.get());
+    }
+
+    if (profiler && args.size() <= 1)
+    {
+        interpreter.set_profiler(profiler.get());
+        profiler->start();
+    }
+
+    if (args.empty())
     {
         run_prompt();
     }
-    else if (argc == 2)
+    else if (args.size() == 1)
     {
-        run_script(argv[1]);
+        run_script(args[0]);
     }
     else
     {
-        cout << "Usage:\n    halo - REPL mode\n    halo script.halo - file mode" << endl;
+        cout << "Usage:\n    halo [options] - REPL mode\n    halo [options] script.halo - file mode\n"
+             << "Options:\n"
+             << "    --vm - run on the bytecode virtual machine\n"
+             << "    --gc-stats - print the GC statistics to stderr at exit\n"
+             << "    --profile[=file] - sample the call stack, write it as folded stacks to the file (halo.folded by default)\n"
+             << "                       and print the functions and lines that took the most time to stderr at exit\n"
+             << "    --counters[=file] - count the runs and allocations of each line and the calls of each function, write them\n"
+             << "                        to the file at exit, as JSON if its name ends with .json, else as LCOV (halo.info by default)\n"
+             << "GC environment variables:\n"
+             << "    HALO_GC_HEAP_SIZE - old generation size, in objects, that starts the first major collection\n"
+             << "    HALO_GC_GROWTH - how much the old generation may grow after a major collection\n"
+             << "    HALO_GC_NURSERY_SIZE - number of objects allocated between minor collections\n"
+             << "    HALO_GC_STEP_BUDGET - work done by an incremental major collection per minor collection\n"
+             << "    HALO_GC_THREADS - number of threads of a major collection" << endl;
+        return 0;
     }
-}
 
-string to_str(Object *o)
-{
-    return !o ? "null"s : o->to_str();
+    if (gc_stats)
+    {
+        GC::instance().print_stats(cerr);
+    }
+
+    if (profiler)
+    {
+        profiler->stop();
+        interpreter.set_profiler(nullptr);
+
+        ofstream folded(folded_file);
+
+        if (!folded)
+        {
+            cerr << "The profile file cannot be written: " << folded_file << endl;
+        }
+        else
+        {
+            profiler->report_folded(folded);
+        }
+
+        profiler->report_top(cerr);
+    }
+
+    if (counters)
+    {
+        interpreter.set_counters(nullptr);
+
+        ofstream out(counters_file);
+        bool json = counters_file.size() >= 5 && counters_file.compare(counters_file.size() - 5, 5, ".json") == 0;
+
+        if (!out)
+        {
+            cerr << "The counters file cannot be written: " << counters_file << endl;
+        }
+        else if (json)
+        {
+            counters->report_json(out);
+        }
+        else
+        {
+            counters->report_lcov(out);
+        }
+    }
 }
 
 void prompt(const string &c)
@@ -81,11 +196,23 @@ void prompt(const string &c)
                 return;
             }
 
-            cout << to_str(interpreter.evaluate(expr)) << endl;
+            cout << (vm ? vm->evaluate(expr) : interpreter.evaluate(expr)).to_str() << endl;
         }
         else
         {
-            interpreter.execute(parsers.back()->statements());
+            if (Counters *counters = interpreter.get_counters())
+            {
+                counters->add_program(parsers.back()->statements());
+            }
+
+            if (vm)
+            {
+                vm->execute(parsers.back()->statements());
+            }
+            else
+            {
+                interpreter.execute(parsers.back()->statements());
+            }
         }
     }
     catch (const exception &e)
@@ -104,7 +231,19 @@ void script(const string &c)
         Parser parser(t);
         parser.parse();
 
-        interpreter.execute(parser.statements());
+        if (Counters *counters = interpreter.get_counters())
+        {
+            counters->add_program(parser.statements());
+        }
+
+        if (vm)
+        {
+            vm->execute(parser.statements());
+        }
+        else
+        {
+            interpreter.execute(parser.statements());
+        }
     }
     catch (const exception &e)
     {
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "object.hpp"
+#include "token.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+
+namespace halo
+{
+    enum class OpCode : uint8_t
+    {
+        Constant,           // u16 constant
+        Null,
+        Pop,
+        GetGlobal,          // u16 name
+        DefineGlobal,       // u16 name
+        AssignGlobal,       // u16 name
+        GetLocal,           // u16 name, u8 depth, u16 slot
+        DefineLocal,        // u16 name, u16 slot
+        AssignLocal,        // u16 name, u8 depth, u16 slot
+        StoreLocal,         // u16 slot, binds the loop variable in the innermost scope
+        GetField,           // u16 name, u16 field cache
+        SetField,           // u16 name, u16 field cache
+        GetIndex,
+        SetIndex,
+        JumpIfNotIndexable, // u16 offset
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        Not,
+        Negate,
+        Jump,               // u16 offset
+        JumpIfFalse,        // u16 offset
+        JumpIfTrueOrPop,    // u16 offset
+        JumpIfFalseOrPop,   // u16 offset
+        Loop,               // u16 offset
+        CheckNull,          // u8 null check
+        PrepareCall,        // u8 argc
+        Call,               // u8 argc, u16 call site
+        Invoke,             // u16 name, u8 argc, u16 call site
+        MakeList,           // u16 count
+        MakeDict,           // u16 count of the pairs
+        MakeSet,            // u16 count
+        MakeLambda,         // u16 lambda
+        DefFun,             // u16 fun
+        DefClass,           // u16 class
+        EnterScope,         // u8 scope type, u16 size
+        ExitScope,          // u8 count
+        Return,
+        RangeInit,
+        RangeNext,          // u16 offset
+        RangeStep,
+        IterInit,
+        IterNext,           // u16 offset
+        Error,              // u16 constant
+        CountLine           // u16 constant, the line of the next statement, only emitted while lines are counted
+    };
+
+    enum class NullCheck : uint8_t
+    {
+        Call,
+        RangeBegin,
+        RangeEnd,
+        RangeStep
+    };
+
+    enum class NodeKind : uint8_t
+    {
+        None,
+        BinaryExpr,
+        LogicalExpr,
+        UnaryExpr,
+        CallExpr,
+        DotExpr,
+        SubscriptExpr,
+        Literal,
+        Var,
+        Lambda,
+        List,
+        Dict,
+        Set,
+        VarStmt,
+        AssignmentStmt,
+        ExpressionStmt,
+        IfStmt,
+        WhileStmt,
+        ForStmt,
+        BreakStmt,
+        ContinueStmt,
+        FunStmt,
+        ReturnStmt,
+        ClassStmt
+    };
+
+    inline const char *node_kind_name(NodeKind kind)
+    {
+        static const char *names[] = {
+            "",
+            "binary expression",
+            "logical expression",
+            "unary expression",
+            "call expression",
+            "dot expression",
+            "subscript expression",
+            "literal",
+            "variable",
+            "lambda",
+            "list",
+            "dict",
+            "set",
+            "var statement",
+            "assignment statement",
+            "expression statement",
+            "if statement",
+            "while statement",
+            "for statement",
+            "break statement",
+            "continue statement",
+            "fun statement",
+            "return statement",
+            "class statement"};
+
+        return names[static_cast<size_t>(kind)];
+    }
+
+    struct Chunk
+    {
+        struct DebugEntry
+        {
+            size_t m_offset;
+            size_t m_line;
+            NodeKind m_kind;
+        };
+
+        struct CallSite
+        {
+            size_t m_line;
+            // of an Invoke
+            MethodCache m_method_cache;
+        };
+
+        struct IterRegion
+        {
+            size_t m_begin;
+            size_t m_end;
+            size_t m_handler;
+        };
+
+        struct FunProto
+        {
+            FunStmt *m_fst;
+            Chunk *m_chunk;
+        };
+
+        struct LambdaProto
+        {
+            Lambda *m_l;
+            Chunk *m_chunk;
+        };
+
+        struct ClassProto
+        {
+            ClassStmt *m_cst;
+            std::vector<Chunk *> m_methods;
+        };
+
+        std::vector<uint8_t> m_code;
+        std::vector<Value> m_constants;
+        std::vector<Token> m_names;
+        std::vector<CallSite> m_calls;
+        std::vector<FieldCache> m_field_caches;
+        std::vector<FunProto> m_funs;
+        std::vector<LambdaProto> m_lambdas;
+        std::vector<ClassProto> m_classes;
+        std::vector<IterRegion> m_iter_regions;
+
+        // sparse line table: a new entry starts wherever the line or the node kind changes
+        std::vector<DebugEntry> m_debug;
+
+        const DebugEntry *debug_entry(size_t offset) const
+        {
+            const DebugEntry *res = nullptr;
+
+            size_t lo = 0;
+            size_t hi = m_debug.size();
+
+            while (lo < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+
+                if (m_debug[mid].m_offset <= offset)
+                {
+                    res = &m_debug[mid];
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+
+            return res;
+        }
+    };
+}
\ No newline at end of file
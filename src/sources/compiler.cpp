@@ -0,0 +1,827 @@
+#include "compiler.hpp"
+#include "gc.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace halo;
+
+Compiler::Compiler(std::vector<std::unique_ptr<Chunk>> &chunks, bool count_lines)
+    : m_chunks(chunks), m_chunk(nullptr), m_scope_depth(0), m_count_lines(count_lines)
+{
+}
+
+Chunk *Compiler::compile(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    m_chunk = new_chunk();
+    m_scope_depth = 0;
+
+    compile_block(stmts);
+
+    emit(OpCode::Null);
+    emit(OpCode::Return);
+
+    return m_chunk;
+}
+
+Chunk *Compiler::compile(Expr *e)
+{
+    m_chunk = new_chunk();
+    m_scope_depth = 0;
+
+    e->visit(this);
+
+    emit(OpCode::Return);
+
+    return m_chunk;
+}
+
+Chunk *Compiler::new_chunk()
+{
+    m_chunks.push_back(make_unique<Chunk>());
+    return m_chunks.back().get();
+}
+
+Chunk *Compiler::compile_body(const std::vector<std::unique_ptr<Stmt>> &body)
+{
+    Chunk *enclosing = m_chunk;
+    vector<Loop> enclosing_loops = move(m_loops);
+    size_t enclosing_depth = m_scope_depth;
+
+    m_chunk = new_chunk();
+    m_loops.clear();
+    m_scope_depth = 0;
+
+    compile_block(body);
+
+    emit(OpCode::Null);
+    emit(OpCode::Return);
+
+    Chunk *res = m_chunk;
+
+    m_chunk = enclosing;
+    m_loops = move(enclosing_loops);
+    m_scope_depth = enclosing_depth;
+
+    return res;
+}
+
+void Compiler::compile_block(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    for (auto &stmt : stmts)
+    {
+        if (m_count_lines)
+        {
+            emit(OpCode::CountLine);
+            emit_u16(add_constant(Value::integer(stmt->m_line)));
+        }
+
+        stmt->visit(this);
+    }
+}
+
+/*
+    EMITTING
+*/
+
+void Compiler::emit(OpCode op)
+{
+    size_t line = m_context.empty() ? 0 : m_context.back().m_line;
+    NodeKind kind = m_context.empty() ? NodeKind::None : m_context.back().m_kind;
+
+    if (m_chunk->m_debug.empty() || m_chunk->m_debug.back().m_line != line || m_chunk->m_debug.back().m_kind != kind)
+    {
+        m_chunk->m_debug.push_back({m_chunk->m_code.size(), line, kind});
+    }
+
+    m_chunk->m_code.push_back(static_cast<uint8_t>(op));
+}
+
+void Compiler::emit_u8(size_t val)
+{
+    if (val > UINT8_MAX)
+    {
+        compile_error("too many operands");
+    }
+
+    m_chunk->m_code.push_back(static_cast<uint8_t>(val));
+}
+
+void Compiler::emit_u16(size_t val)
+{
+    if (val > UINT16_MAX)
+    {
+        compile_error("too many operands");
+    }
+
+    m_chunk->m_code.push_back(static_cast<uint8_t>(val >> 8));
+    m_chunk->m_code.push_back(static_cast<uint8_t>(val & 0xff));
+}
+
+size_t Compiler::emit_jump(OpCode op)
+{
+    emit(op);
+    m_chunk->m_code.push_back(0xff);
+    m_chunk->m_code.push_back(0xff);
+    return m_chunk->m_code.size() - 2;
+}
+
+void Compiler::patch_jump(size_t at)
+{
+    size_t jump = m_chunk->m_code.size() - at - 2;
+
+    if (jump > UINT16_MAX)
+    {
+        compile_error("too much code to jump over");
+    }
+
+    m_chunk->m_code[at] = static_cast<uint8_t>(jump >> 8);
+    m_chunk->m_code[at + 1] = static_cast<uint8_t>(jump & 0xff);
+}
+
+void Compiler::emit_loop(size_t start)
+{
+    emit(OpCode::Loop);
+
+    size_t jump = m_chunk->m_code.size() + 2 - start;
+
+    if (jump > UINT16_MAX)
+    {
+        compile_error("loop body is too large");
+    }
+
+    emit_u16(jump);
+}
+
+// a block the resolver sized 0 declares no variables and runs in the enclosing scope
+void Compiler::emit_enter_scope(Environment::ScopeType st, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    emit(OpCode::EnterScope);
+    emit_u8(static_cast<size_t>(st));
+    emit_u16(size);
+    ++m_scope_depth;
+}
+
+void Compiler::emit_variable(OpCode global_op, OpCode local_op, const Token &t, const Location &loc)
+{
+    if (loc.is_global())
+    {
+        emit(global_op);
+        emit_u16(add_name(t));
+        return;
+    }
+
+    emit(local_op);
+    emit_u16(add_name(t));
+
+    if (local_op != OpCode::DefineLocal)
+    {
+        emit_u8(loc.m_depth);
+    }
+
+    emit_u16(loc.m_slot);
+}
+
+void Compiler::emit_leave_scope(size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    emit_exit_scope(1);
+    --m_scope_depth;
+}
+
+void Compiler::emit_exit_scope(size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    emit(OpCode::ExitScope);
+    emit_u8(count);
+}
+
+size_t Compiler::add_constant(Value v)
+{
+    m_chunk->m_constants.push_back(v);
+    return m_chunk->m_constants.size() - 1;
+}
+
+size_t Compiler::add_name(const Token &t)
+{
+    for (size_t i = 0; i < m_chunk->m_names.size(); ++i)
+    {
+        if (m_chunk->m_names[i].symbol() == t.symbol())
+        {
+            return i;
+        }
+    }
+
+    m_chunk->m_names.push_back(t);
+    return m_chunk->m_names.size() - 1;
+}
+
+size_t Compiler::add_call_site(size_t line)
+{
+    m_chunk->m_calls.push_back({line, MethodCache()});
+    return m_chunk->m_calls.size() - 1;
+}
+
+size_t Compiler::add_field_cache()
+{
+    m_chunk->m_field_caches.emplace_back();
+    return m_chunk->m_field_caches.size() - 1;
+}
+
+void Compiler::compile_error(const std::string &desc)
+{
+    size_t line = m_context.empty() ? 0 : m_context.back().m_line;
+    NodeKind kind = m_context.empty() ? NodeKind::None : m_context.back().m_kind;
+
+    throw runtime_error("Compile error\n    line " + to_string(line) + ": <" + node_kind_name(kind) + "> " + desc);
+}
+
+/*
+    EXPRESSIONS
+*/
+
+Value Compiler::visit_grouping(Grouping *e)
+{
+    e->expr->visit(this);
+    return nullptr;
+}
+
+Value Compiler::visit_binary_expr(BinaryExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::BinaryExpr);
+
+    e->m_left->visit(this);
+    e->m_right->visit(this);
+
+    switch (e->m_token.m_type)
+    {
+    case TokenType::Plus:
+        emit(OpCode::Add);
+        break;
+    case TokenType::Minus:
+        emit(OpCode::Subtract);
+        break;
+    case TokenType::Mul:
+        emit(OpCode::Multiply);
+        break;
+    case TokenType::Div:
+        emit(OpCode::Divide);
+        break;
+    case TokenType::Mod:
+        emit(OpCode::Modulo);
+        break;
+    case TokenType::Less:
+        emit(OpCode::Less);
+        break;
+    case TokenType::LessEqual:
+        emit(OpCode::LessEqual);
+        break;
+    case TokenType::Greater:
+        emit(OpCode::Greater);
+        break;
+    case TokenType::GreaterEqual:
+        emit(OpCode::GreaterEqual);
+        break;
+    case TokenType::EqualEqual:
+        emit(OpCode::Equal);
+        break;
+    case TokenType::BangEqual:
+        emit(OpCode::NotEqual);
+        break;
+    default:
+        compile_error("unknown operator '" + e->m_token.m_lexeme + "'");
+    }
+
+    return nullptr;
+}
+
+Value Compiler::visit_logical_expr(LogicalExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::LogicalExpr);
+
+    e->m_left->visit(this);
+
+    size_t jump = emit_jump(e->m_token.m_type == TokenType::Or ? OpCode::JumpIfTrueOrPop : OpCode::JumpIfFalseOrPop);
+    e->m_right->visit(this);
+    patch_jump(jump);
+
+    return nullptr;
+}
+
+Value Compiler::visit_unary_expr(UnaryExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::UnaryExpr);
+
+    e->m_expr->visit(this);
+
+    switch (e->m_token.m_type)
+    {
+    case TokenType::Not:
+        emit(OpCode::Not);
+        break;
+    case TokenType::Minus:
+        emit(OpCode::Negate);
+        break;
+    default:
+        compile_error("incorrect operand type for '" + e->m_token.m_lexeme + "' operator");
+    }
+
+    return nullptr;
+}
+
+Value Compiler::visit_call_expr(Call *e)
+{
+    // no context of its own: the checks before the call are reported in the enclosing node,
+    // the call itself is put on the call stack by the vm
+
+    if (auto p = dynamic_cast<Dot *>(e->m_expr))
+    {
+        p->m_expr->visit(this);
+        emit(OpCode::CheckNull);
+        emit_u8(static_cast<size_t>(NullCheck::Call));
+
+        for (auto arg : e->m_args)
+        {
+            arg->visit(this);
+        }
+
+        emit(OpCode::Invoke);
+        emit_u16(add_name(p->m_name));
+        emit_u8(e->m_args.size());
+        emit_u16(add_call_site(e->m_line));
+
+        return nullptr;
+    }
+
+    e->m_expr->visit(this);
+    emit(OpCode::PrepareCall);
+    emit_u8(e->m_args.size());
+
+    for (auto arg : e->m_args)
+    {
+        arg->visit(this);
+    }
+
+    emit(OpCode::Call);
+    emit_u8(e->m_args.size());
+    emit_u16(add_call_site(e->m_line));
+
+    return nullptr;
+}
+
+Value Compiler::visit_dot_expr(Dot *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::DotExpr);
+
+    e->m_expr->visit(this);
+    emit(OpCode::GetField);
+    emit_u16(add_name(e->m_name));
+    emit_u16(add_field_cache());
+
+    return nullptr;
+}
+
+Value Compiler::visit_subscript_expr(Subscript *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::SubscriptExpr);
+
+    e->m_expr->visit(this);
+    size_t not_indexable = emit_jump(OpCode::JumpIfNotIndexable);
+
+    e->m_index->visit(this);
+    emit(OpCode::GetIndex);
+    size_t end = emit_jump(OpCode::Jump);
+
+    patch_jump(not_indexable);
+    emit(OpCode::Pop);
+    emit(OpCode::Null);
+
+    patch_jump(end);
+
+    return nullptr;
+}
+
+Value Compiler::visit_literal(Literal *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Literal);
+
+    Value v;
+
+    try
+    {
+        switch (e->m_token.m_type)
+        {
+        case TokenType::Null:
+            emit(OpCode::Null);
+            return nullptr;
+        case TokenType::IntLiteral:
+            v = Value::integer(stoll(e->m_token.m_lexeme));
+            break;
+        case TokenType::FloatLiteral:
+            v = Value::floating(stod(e->m_token.m_lexeme));
+            break;
+        case TokenType::True:
+        case TokenType::False:
+            v = Value::boolean(e->m_token.m_type == TokenType::True);
+            break;
+        case TokenType::StrLiteral:
+        {
+            Object *o = GC::instance().new_object(ObjectType::String);
+            o->m_eternal = true;
+            static_cast<String *>(o)->m_val = e->m_token.m_lexeme;
+            v = o;
+            break;
+        }
+        default:
+            compile_error("unknown literal '" + e->m_token.m_lexeme + "'");
+        }
+    }
+    catch (const std::logic_error &)
+    {
+        // a malformed number is reported only if the literal is actually evaluated
+
+        Object *o = GC::instance().new_object(ObjectType::String);
+        o->m_eternal = true;
+        static_cast<String *>(o)->m_val = e->m_token.m_type == TokenType::IntLiteral ? "invalid integer literal" : "invalid floating point literal";
+
+        emit(OpCode::Error);
+        emit_u16(add_constant(o));
+        return nullptr;
+    }
+
+    emit(OpCode::Constant);
+    emit_u16(add_constant(v));
+
+    return nullptr;
+}
+
+Value Compiler::visit_var(Var *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Var);
+
+    emit_variable(OpCode::GetGlobal, OpCode::GetLocal, e->m_token, e->m_loc);
+
+    return nullptr;
+}
+
+Value Compiler::visit_lambda(Lambda *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Lambda);
+
+    Chunk *body = compile_body(e->m_body);
+    m_chunk->m_lambdas.push_back({e, body});
+
+    emit(OpCode::MakeLambda);
+    emit_u16(m_chunk->m_lambdas.size() - 1);
+
+    return nullptr;
+}
+
+Value Compiler::visit_list(ListExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::List);
+
+    for (auto el : e->m_params)
+    {
+        el->visit(this);
+    }
+
+    emit(OpCode::MakeList);
+    emit_u16(e->m_params.size());
+
+    return nullptr;
+}
+
+Value Compiler::visit_dict(DictExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Dict);
+
+    for (size_t i = 0; i < e->m_keys.size(); ++i)
+    {
+        e->m_keys[i]->visit(this);
+        e->m_vals[i]->visit(this);
+    }
+
+    emit(OpCode::MakeDict);
+    emit_u16(e->m_keys.size());
+
+    return nullptr;
+}
+
+Value Compiler::visit_set(SetExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Set);
+
+    for (auto el : e->m_params)
+    {
+        el->visit(this);
+    }
+
+    emit(OpCode::MakeSet);
+    emit_u16(e->m_params.size());
+
+    return nullptr;
+}
+
+/*
+    STATEMENTS
+*/
+
+void Compiler::visit_var_stmt(VarStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::VarStmt);
+
+    if (e->m_expr)
+    {
+        e->m_expr->visit(this);
+    }
+    else
+    {
+        emit(OpCode::Null);
+    }
+
+    emit_variable(OpCode::DefineGlobal, OpCode::DefineLocal, e->m_token, e->m_loc);
+}
+
+void Compiler::visit_assignment_stmt(AssignmentStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::AssignmentStmt);
+
+    if (auto p = dynamic_cast<Var *>(e->m_lval))
+    {
+        e->m_expr->visit(this);
+        emit_variable(OpCode::AssignGlobal, OpCode::AssignLocal, p->m_token, p->m_loc);
+        return;
+    }
+    if (auto p2 = dynamic_cast<Dot *>(e->m_lval))
+    {
+        p2->m_expr->visit(this);
+        e->m_expr->visit(this);
+        emit(OpCode::SetField);
+        emit_u16(add_name(p2->m_name));
+        emit_u16(add_field_cache());
+        return;
+    }
+    if (auto p3 = dynamic_cast<Subscript *>(e->m_lval))
+    {
+        p3->m_expr->visit(this);
+        size_t not_indexable = emit_jump(OpCode::JumpIfNotIndexable);
+
+        p3->m_index->visit(this);
+        e->m_expr->visit(this);
+        emit(OpCode::SetIndex);
+        size_t end = emit_jump(OpCode::Jump);
+
+        patch_jump(not_indexable);
+        emit(OpCode::Pop);
+
+        patch_jump(end);
+        return;
+    }
+
+    compile_error("can be used only with variables or object fields");
+}
+
+void Compiler::visit_expression_stmt(ExpressionStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::ExpressionStmt);
+
+    e->m_expr->visit(this);
+    emit(OpCode::Pop);
+}
+
+void Compiler::visit_if_stmt(IfStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::IfStmt);
+
+    vector<size_t> end_jumps;
+
+    for (size_t i = 0; i < e->m_conds.size(); ++i)
+    {
+        e->m_conds[i]->visit(this);
+        size_t next = emit_jump(OpCode::JumpIfFalse);
+
+        emit_enter_scope(Environment::ScopeType::If, e->m_then_sizes[i]);
+        compile_block(e->m_then_branches[i]);
+        emit_leave_scope(e->m_then_sizes[i]);
+
+        end_jumps.push_back(emit_jump(OpCode::Jump));
+        patch_jump(next);
+    }
+
+    if (!e->m_else_branch.empty())
+    {
+        emit_enter_scope(Environment::ScopeType::If, e->m_else_size);
+        compile_block(e->m_else_branch);
+        emit_leave_scope(e->m_else_size);
+    }
+
+    for (auto jump : end_jumps)
+    {
+        patch_jump(jump);
+    }
+}
+
+void Compiler::visit_while_stmt(WhileStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::WhileStmt);
+
+    size_t start = m_chunk->m_code.size();
+
+    e->m_cond->visit(this);
+    size_t exit = emit_jump(OpCode::JumpIfFalse);
+
+    m_loops.push_back({m_scope_depth, {}, {}});
+
+    emit_enter_scope(Environment::ScopeType::While, e->m_do_size);
+    compile_block(e->m_do_branch);
+    emit_leave_scope(e->m_do_size);
+
+    for (auto jump : m_loops.back().m_continue_jumps)
+    {
+        patch_jump(jump);
+    }
+
+    emit_loop(start);
+    patch_jump(exit);
+
+    for (auto jump : m_loops.back().m_break_jumps)
+    {
+        patch_jump(jump);
+    }
+
+    m_loops.pop_back();
+}
+
+void Compiler::visit_for_stmt(ForStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::ForStmt);
+
+    size_t start = 0;
+    size_t exit = 0;
+    size_t region_begin = 0;
+    size_t handler = 0;
+    size_t stack_slots = 0;
+
+    if (e->m_begin)
+    {
+        e->m_begin->visit(this);
+        emit(OpCode::CheckNull);
+        emit_u8(static_cast<size_t>(NullCheck::RangeBegin));
+
+        e->m_end->visit(this);
+        emit(OpCode::CheckNull);
+        emit_u8(static_cast<size_t>(NullCheck::RangeEnd));
+
+        if (e->m_step)
+        {
+            e->m_step->visit(this);
+            emit(OpCode::CheckNull);
+            emit_u8(static_cast<size_t>(NullCheck::RangeStep));
+        }
+        else
+        {
+            emit(OpCode::Constant);
+            emit_u16(add_constant(Value::integer(1)));
+        }
+
+        emit(OpCode::RangeInit);
+        stack_slots = 3;
+
+        emit_enter_scope(Environment::ScopeType::ForHeader, e->m_header_size);
+
+        start = m_chunk->m_code.size();
+        exit = emit_jump(OpCode::RangeNext);
+    }
+    else
+    {
+        e->m_iterable->visit(this);
+
+        emit_enter_scope(Environment::ScopeType::ForHeader, e->m_header_size);
+
+        handler = m_chunk->m_code.size();
+        emit(OpCode::IterInit);
+        stack_slots = 2;
+
+        start = m_chunk->m_code.size();
+        region_begin = start;
+        exit = emit_jump(OpCode::IterNext);
+    }
+
+    m_loops.push_back({m_scope_depth, {}, {}});
+
+    // RangeNext and IterNext leave the value of the loop variable on the stack
+    emit_enter_scope(Environment::ScopeType::For, e->m_do_size);
+    emit(OpCode::StoreLocal);
+    emit_u16(e->m_loc.m_slot);
+
+    compile_block(e->m_do_branch);
+    emit_leave_scope(e->m_do_size);
+
+    for (auto jump : m_loops.back().m_continue_jumps)
+    {
+        patch_jump(jump);
+    }
+
+    if (e->m_begin)
+    {
+        emit(OpCode::RangeStep);
+    }
+
+    emit_loop(start);
+
+    if (!e->m_begin)
+    {
+        m_chunk->m_iter_regions.push_back({region_begin, m_chunk->m_code.size(), handler});
+    }
+
+    patch_jump(exit);
+
+    for (auto jump : m_loops.back().m_break_jumps)
+    {
+        patch_jump(jump);
+    }
+
+    m_loops.pop_back();
+
+    for (size_t i = 0; i < stack_slots; ++i)
+    {
+        emit(OpCode::Pop);
+    }
+
+    emit_leave_scope(e->m_header_size);
+}
+
+void Compiler::visit_break_stmt(BreakStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::BreakStmt);
+
+    emit_exit_scope(m_scope_depth - m_loops.back().m_scope_depth);
+    m_loops.back().m_break_jumps.push_back(emit_jump(OpCode::Jump));
+}
+
+void Compiler::visit_continue_stmt(ContinueStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::ContinueStmt);
+
+    emit_exit_scope(m_scope_depth - m_loops.back().m_scope_depth);
+    m_loops.back().m_continue_jumps.push_back(emit_jump(OpCode::Jump));
+}
+
+void Compiler::visit_fun_stmt(FunStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::FunStmt);
+
+    Chunk *body = compile_body(e->m_body);
+    m_chunk->m_funs.push_back({e, body});
+
+    emit(OpCode::DefFun);
+    emit_u16(m_chunk->m_funs.size() - 1);
+}
+
+void Compiler::visit_return_stmt(ReturnStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::ReturnStmt);
+
+    if (e->m_expr)
+    {
+        e->m_expr->visit(this);
+    }
+    else
+    {
+        emit(OpCode::Null);
+    }
+
+    emit(OpCode::Return);
+}
+
+void Compiler::visit_class_stmt(ClassStmt *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::ClassStmt);
+
+    Chunk::ClassProto proto{e, {}};
+
+    for (const auto &f : e->m_methods)
+    {
+        proto.m_methods.push_back(compile_body(f->m_body));
+    }
+
+    m_chunk->m_classes.push_back(move(proto));
+
+    emit(OpCode::DefClass);
+    emit_u16(m_chunk->m_classes.size() - 1);
+}
\ No newline at end of file
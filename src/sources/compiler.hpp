@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "chunk.hpp"
+#include "env.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+
+namespace halo
+{
+    class Compiler : public ExprVisitor, public StmtVisitor
+    {
+        struct Context
+        {
+            size_t m_line;
+            NodeKind m_kind;
+        };
+
+        struct ContextManager
+        {
+            Compiler *m_compiler;
+
+            ContextManager(Compiler *compiler, size_t line, NodeKind kind)
+                : m_compiler(compiler)
+            {
+                m_compiler->m_context.push_back({line, kind});
+            }
+
+            ~ContextManager()
+            {
+                m_compiler->m_context.pop_back();
+            }
+        };
+
+        struct Loop
+        {
+            size_t m_scope_depth;
+            std::vector<size_t> m_continue_jumps;
+            std::vector<size_t> m_break_jumps;
+        };
+
+        std::vector<std::unique_ptr<Chunk>> &m_chunks;
+        Chunk *m_chunk;
+        std::vector<Context> m_context;
+        std::vector<Loop> m_loops;
+        size_t m_scope_depth;
+        bool m_count_lines;
+
+        Chunk *new_chunk();
+        Chunk *compile_body(const std::vector<std::unique_ptr<Stmt>> &body);
+
+        void emit(OpCode op);
+        void emit_u8(size_t val);
+        void emit_u16(size_t val);
+        size_t emit_jump(OpCode op);
+        void patch_jump(size_t at);
+        void emit_loop(size_t start);
+        void emit_enter_scope(Environment::ScopeType st, size_t size);
+        void emit_variable(OpCode global_op, OpCode local_op, const Token &t, const Location &loc);
+        void emit_leave_scope(size_t size);
+        void emit_exit_scope(size_t count);
+
+        size_t add_constant(Value v);
+        size_t add_name(const Token &t);
+        size_t add_call_site(size_t line);
+        size_t add_field_cache();
+
+        void compile_block(const std::vector<std::unique_ptr<Stmt>> &stmts);
+
+        [[noreturn]] void compile_error(const std::string &desc);
+
+    public:
+        Compiler(std::vector<std::unique_ptr<Chunk>> &chunks, bool count_lines = false);
+
+        Chunk *compile(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        Chunk *compile(Expr *e);
+
+        Value visit_grouping(Grouping *e) override;
+        Value visit_binary_expr(BinaryExpr *e) override;
+        Value visit_logical_expr(LogicalExpr *e) override;
+        Value visit_unary_expr(UnaryExpr *e) override;
+        Value visit_call_expr(Call *e) override;
+        Value visit_dot_expr(Dot *e) override;
+        Value visit_subscript_expr(Subscript *e) override;
+        Value visit_literal(Literal *e) override;
+        Value visit_var(Var *e) override;
+        Value visit_lambda(Lambda *e) override;
+        Value visit_list(ListExpr *e) override;
+        Value visit_dict(DictExpr *e) override;
+        Value visit_set(SetExpr *e) override;
+
+        void visit_var_stmt(VarStmt *e) override;
+        void visit_assignment_stmt(AssignmentStmt *e) override;
+        void visit_expression_stmt(ExpressionStmt *e) override;
+        void visit_if_stmt(IfStmt *e) override;
+        void visit_while_stmt(WhileStmt *e) override;
+        void visit_for_stmt(ForStmt *e) override;
+        void visit_break_stmt(BreakStmt *e) override;
+        void visit_continue_stmt(ContinueStmt *e) override;
+        void visit_fun_stmt(FunStmt *e) override;
+        void visit_return_stmt(ReturnStmt *e) override;
+        void visit_class_stmt(ClassStmt *e) override;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include "counters.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace halo;
+
+namespace
+{
+    // finds the statements and the functions of a program, including the bodies of lambdas
+    struct Collector : ExprVisitor, StmtVisitor
+    {
+        Counters &m_counters;
+
+        Collector(Counters &counters)
+            : m_counters(counters)
+        {
+        }
+
+        void block(const std::vector<std::unique_ptr<Stmt>> &stmts)
+        {
+            for (auto &stmt : stmts)
+            {
+                m_counters.add_line(stmt->m_line);
+                stmt->visit(this);
+            }
+        }
+
+        void expr(Expr *e)
+        {
+            if (e)
+            {
+                e->visit(this);
+            }
+        }
+
+        Value visit_grouping(Grouping *e) override
+        {
+            expr(e->expr);
+            return nullptr;
+        }
+
+        Value visit_binary_expr(BinaryExpr *e) override
+        {
+            expr(e->m_left);
+            expr(e->m_right);
+            return nullptr;
+        }
+
+        Value visit_logical_expr(LogicalExpr *e) override
+        {
+            expr(e->m_left);
+            expr(e->m_right);
+            return nullptr;
+        }
+
+        Value visit_unary_expr(UnaryExpr *e) override
+        {
+            expr(e->m_expr);
+            return nullptr;
+        }
+
+        Value visit_call_expr(Call *e) override
+        {
+            expr(e->m_expr);
+
+            for (auto arg : e->m_args)
+            {
+                expr(arg);
+            }
+
+            return nullptr;
+        }
+
+        Value visit_dot_expr(Dot *e) override
+        {
+            expr(e->m_expr);
+            return nullptr;
+        }
+
+        Value visit_subscript_expr(Subscript *e) override
+        {
+            expr(e->m_expr);
+            expr(e->m_index);
+            return nullptr;
+        }
+
+        Value visit_literal([[maybe_unused]] Literal *e) override
+        {
+            return nullptr;
+        }
+
+        Value visit_var([[maybe_unused]] Var *e) override
+        {
+            return nullptr;
+        }
+
+        Value visit_lambda(Lambda *e) override
+        {
+            m_counters.add_function(e, "lambda", e->m_line);
+            block(e->m_body);
+            return nullptr;
+        }
+
+        Value visit_list(ListExpr *e) override
+        {
+            for (auto param : e->m_params)
+            {
+                expr(param);
+            }
+
+            return nullptr;
+        }
+
+        Value visit_dict(DictExpr *e) override
+        {
+            for (size_t i = 0; i < e->m_keys.size(); ++i)
+            {
+                expr(e->m_keys[i]);
+                expr(e->m_vals[i]);
+            }
+
+            return nullptr;
+        }
+
+        Value visit_set(SetExpr *e) override
+        {
+            for (auto param : e->m_params)
+            {
+                expr(param);
+            }
+
+            return nullptr;
+        }
+
+        void visit_var_stmt(VarStmt *e) override
+        {
+            expr(e->m_expr);
+        }
+
+        void visit_assignment_stmt(AssignmentStmt *e) override
+        {
+            expr(e->m_lval);
+            expr(e->m_expr);
+        }
+
+        void visit_expression_stmt(ExpressionStmt *e) override
+        {
+            expr(e->m_expr);
+        }
+
+        void visit_if_stmt(IfStmt *e) override
+        {
+            for (size_t i = 0; i < e->m_conds.size(); ++i)
+            {
+                expr(e->m_conds[i]);
+                block(e->m_then_branches[i]);
+            }
+
+            block(e->m_else_branch);
+        }
+
+        void visit_while_stmt(WhileStmt *e) override
+        {
+            expr(e->m_cond);
+            block(e->m_do_branch);
+        }
+
+        void visit_for_stmt(ForStmt *e) override
+        {
+            expr(e->m_begin);
+            expr(e->m_end);
+            expr(e->m_step);
+            expr(e->m_iterable);
+            block(e->m_do_branch);
+        }
+
+        void visit_break_stmt([[maybe_unused]] BreakStmt *e) override
+        {
+        }
+
+        void visit_continue_stmt([[maybe_unused]] ContinueStmt *e) override
+        {
+        }
+
+        void visit_fun_stmt(FunStmt *e) override
+        {
+            m_counters.add_function(e, "fun " + e->m_name.m_lexeme, e->m_line);
+            block(e->m_body);
+        }
+
+        void visit_return_stmt(ReturnStmt *e) override
+        {
+            expr(e->m_expr);
+        }
+
+        void visit_class_stmt(ClassStmt *e) override
+        {
+            // a method is not a statement, only its body runs
+            for (auto &method : e->m_methods)
+            {
+                m_counters.add_function(method.get(), "method " + e->m_name.m_lexeme + "." + method->m_name.m_lexeme, method->m_line);
+                block(method->m_body);
+            }
+        }
+    };
+
+    string json_string(const string &s)
+    {
+        string res = "\"";
+
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                res += '\\';
+                res += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                res += buf;
+            }
+            else
+            {
+                res += c;
+            }
+        }
+
+        return res + "\"";
+    }
+}
+
+void Counters::add_program(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    Collector collector(*this);
+    collector.block(stmts);
+}
+
+void Counters::add_line(size_t n)
+{
+    line(n).m_code = true;
+}
+
+void Counters::add_function(const void *key, std::string name, size_t n)
+{
+    Function &fn = m_functions[key];
+    fn.m_name = move(name);
+    fn.m_line = n;
+}
+
+vector<const Counters::Function *> Counters::sorted_functions() const
+{
+    vector<const Function *> res;
+
+    for (const auto &[key, fn] : m_functions)
+    {
+        // called, but not in a program added to the counters
+        if (!fn.m_name.empty())
+        {
+            res.push_back(&fn);
+        }
+    }
+
+    sort(res.begin(), res.end(), [](const Function *a, const Function *b)
+         { return a->m_line != b->m_line ? a->m_line < b->m_line : a->m_name < b->m_name; });
+
+    return res;
+}
+
+void Counters::report_json(ostream &out) const
+{
+    out << "{\n  \"script\": " << json_string(m_script) << ",\n  \"lines\": [";
+
+    bool first = true;
+
+    for (size_t n = 0; n < m_lines.size(); ++n)
+    {
+        const Line &l = m_lines[n];
+
+        if (l.m_code || l.m_hits || l.m_allocations)
+        {
+            out << (first ? "\n" : ",\n")
+                << "    {\"line\": " << n << ", \"hits\": " << l.m_hits << ", \"allocations\": " << l.m_allocations << "}";
+            first = false;
+        }
+    }
+
+    out << (first ? "" : "\n  ") << "],\n  \"functions\": [";
+
+    first = true;
+
+    for (auto fn : sorted_functions())
+    {
+        out << (first ? "\n" : ",\n")
+            << "    {\"name\": " << json_string(fn->m_name) << ", \"line\": " << fn->m_line << ", \"calls\": " << fn->m_calls << "}";
+        first = false;
+    }
+
+    out << (first ? "" : "\n  ") << "]\n}\n";
+}
+
+void Counters::report_lcov(ostream &out) const
+{
+    auto functions = sorted_functions();
+    size_t functions_hit = 0;
+
+    out << "TN:\nSF:" << m_script << "\n";
+
+    // lcov wants unique function names without commas
+    auto lcov_name = [](const Function *fn)
+    {
+        string name = fn->m_name + ":" + to_string(fn->m_line);
+        replace(name.begin(), name.end(), ',', ' ');
+        return name;
+    };
+
+    for (auto fn : functions)
+    {
+        out << "FN:" << fn->m_line << "," << lcov_name(fn) << "\n";
+    }
+
+    for (auto fn : functions)
+    {
+        out << "FNDA:" << fn->m_calls << "," << lcov_name(fn) << "\n";
+        functions_hit += fn->m_calls != 0;
+    }
+
+    out << "FNF:" << functions.size() << "\nFNH:" << functions_hit << "\n";
+
+    size_t lines_found = 0;
+    size_t lines_hit = 0;
+
+    for (size_t n = 1; n < m_lines.size(); ++n)
+    {
+        const Line &l = m_lines[n];
+
+        if (l.m_code || l.m_hits)
+        {
+            out << "DA:" << n << "," << l.m_hits << "\n";
+            ++lines_found;
+            lines_hit += l.m_hits != 0;
+        }
+    }
+
+    out << "LF:" << lines_found << "\nLH:" << lines_hit << "\nend_of_record\n";
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stmt.hpp"
+
+namespace halo
+{
+    // execution counters of a script: how many times each statement line ran and how many
+    // objects each line allocated, and how many times each function, method and lambda was called
+    //
+    // the interpreter and the VM only count while an instance is set, the VM because its code
+    // is then compiled with a CountLine instruction before every statement, so they cost nothing otherwise
+    class Counters
+    {
+    public:
+        struct Line
+        {
+            size_t m_hits = 0;
+            size_t m_allocations = 0;
+            // a statement starts at the line
+            bool m_code = false;
+        };
+
+        struct Function
+        {
+            std::string m_name;
+            size_t m_line = 0;
+            size_t m_calls = 0;
+        };
+
+    private:
+        std::string m_script;
+        // indexed by line
+        std::vector<Line> m_lines;
+        // keyed by the FunStmt of a function or a method and the Lambda of a lambda
+        std::unordered_map<const void *, Function> m_functions;
+
+        Line &line(size_t n)
+        {
+            if (n >= m_lines.size())
+            {
+                m_lines.resize(n + 1);
+            }
+
+            return m_lines[n];
+        }
+
+        std::vector<const Function *> sorted_functions() const;
+
+    public:
+        explicit Counters(std::string script = "")
+            : m_script(std::move(script))
+        {
+        }
+
+        // makes the statements and functions of the program known, so that those that never run are reported too
+        void add_program(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        void add_line(size_t n);
+        void add_function(const void *key, std::string name, size_t n);
+
+        void count_line(size_t n)
+        {
+            ++line(n).m_hits;
+        }
+
+        void count_allocation(size_t n)
+        {
+            ++line(n).m_allocations;
+        }
+
+        void count_call(const void *key)
+        {
+            ++m_functions[key].m_calls;
+        }
+
+        void report_json(std::ostream &out) const;
+        void report_lcov(std::ostream &out) const;
+    };
+}
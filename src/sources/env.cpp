@@ -4,98 +4,151 @@
 using namespace std;
 using namespace halo;
 
-void Environment::define(Token t, Object *o)
+namespace
 {
-    if (m_data.back().find(t.m_lexeme) != m_data.back().end())
-    {
-        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is defined already"));
-    }
+    Object undefined_object;
+}
 
-    m_data.back()[t.m_lexeme] = o;
+Value Environment::undefined()
+{
+    // the tag is set directly, as the global interpreter may need it before undefined_object is constructed
+    Value v;
+    v.m_tag = ObjectType::Object;
+    v.m_obj = &undefined_object;
+    return v;
 }
 
-void Environment::assign(Token t, Object *o)
+bool Environment::is_undefined(const Value &v)
 {
-    auto p = lookup(t);
+    return v.m_tag == ObjectType::Object && v.m_obj == &undefined_object;
+}
 
-    if (!p.second)
+void Environment::define(const Token &t, Value v, const Location &loc)
+{
+    if (loc.is_global())
     {
-        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is not defined"));
-    }
+        if (m_globals.find(t.symbol()) != m_globals.end())
+        {
+            throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is defined already"));
+        }
 
-    p.first->second = o;
-}
+        m_globals[t.symbol()] = v;
+        return;
+    }
 
-Object *Environment::get(Token t)
-{
-    auto p = lookup(t);
+    Value &slot = m_data.back()[loc.m_slot];
 
-    if (!p.second)
+    if (!is_undefined(slot))
     {
-        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is not defined"));
+        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is defined already"));
     }
 
-    return p.first->second;
+    slot = v;
 }
 
-std::pair<std::unordered_map<std::string, Object *>::iterator, bool> Environment::lookup(Token t)
+void Environment::assign(const Token &t, Value v, const Location &loc)
 {
-    size_t i = m_scopes.size();
-
-    while (i != 1)
+    if (loc.is_global())
     {
-        --i;
-
-        auto it = m_data[i].find(t.m_lexeme);
+        auto it = m_globals.find(t.symbol());
 
-        if (it != m_data[i].end())
+        if (it == m_globals.end())
         {
-            return make_pair(it, true);
+            throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is not defined"));
         }
 
-        if (m_scopes[i] == ScopeType::Fun || m_scopes[i] == ScopeType::Lambda)
-        {
-            break;
-        }
+        it->second = v;
+        return;
+    }
+
+    Value &slot = m_data[m_data.size() - 1 - loc.m_depth][loc.m_slot];
+
+    if (is_undefined(slot))
+    {
+        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is not defined"));
     }
 
-    auto it = m_data[0].find(t.m_lexeme);
+    slot = v;
+}
+
+Value Environment::get(const Token &t, const Location &loc)
+{
+    Value res;
+
+    if (loc.is_global())
+    {
+        auto it = m_globals.find(t.symbol());
+        res = it == m_globals.end() ? undefined() : it->second;
+    }
+    else
+    {
+        res = m_data[m_data.size() - 1 - loc.m_depth][loc.m_slot];
+    }
 
-    if (it != m_data[0].end())
+    if (is_undefined(res))
     {
-        return make_pair(it, true);
+        throw runtime_error(m_interp->report_error("name '" + t.m_lexeme + "' is not defined"));
     }
 
-    return make_pair(std::unordered_map<std::string, Object *>::iterator(), false);
+    return res;
+}
+
+void Environment::store(const Location &loc, Value v)
+{
+    m_data.back()[loc.m_slot] = v;
 }
 
-void Environment::add_scope(ScopeType st)
+void Environment::add_scope(ScopeType st, size_t size)
 {
-    m_data.emplace_back();
+    if (m_free.empty())
+    {
+        m_data.emplace_back(size, undefined());
+    }
+    else
+    {
+        m_data.push_back(move(m_free.back()));
+        m_free.pop_back();
+        m_data.back().assign(size, undefined());
+    }
+
     m_scopes.push_back(st);
 }
 
 void Environment::remove_scope()
 {
+    // a lambda moves its captures out of its scope, leaving nothing worth keeping
+    if (m_data.back().capacity() != 0)
+    {
+        m_free.push_back(move(m_data.back()));
+    }
+
     m_data.pop_back();
     m_scopes.pop_back();
 }
 
 void Environment::swap_env(Environment &other)
 {
+    m_globals.swap(other.m_globals);
     m_data.swap(other.m_data);
     m_scopes.swap(other.m_scopes);
 }
 
+// the environment is traced as a root by every collection,
+// so storing into a variable needs no write barrier
 void Environment::mark()
 {
-    for (auto &env : m_data)
+    for (auto &[name, val] : m_globals)
+    {
+        val.mark();
+    }
+
+    for (auto &scope : m_data)
     {
-        for (auto &[str, obj] : env)
+        for (auto &val : scope)
         {
-            if (obj && !obj->m_marked)
+            if (!is_undefined(val))
             {
-                obj->mark();
+                val.mark();
             }
         }
     }
@@ -6,6 +6,7 @@
 
 #include "object.hpp"
 #include "token.hpp"
+#include "expr.hpp"
 
 namespace halo
 {
@@ -28,8 +29,14 @@ namespace halo
             Class
         };
 
-        std::vector<std::unordered_map<std::string, Object *>> m_data;
+        // names defined outside of any block or function live in m_globals and are found by symbol,
+        // every other scope is a flat array of slots assigned by the resolver
+        std::unordered_map<Symbol, Value> m_globals;
+        std::vector<std::vector<Value>> m_data;
         std::vector<ScopeType> m_scopes;
+
+        // the slot arrays of removed scopes, reused by the next scopes so that entering a scope does not allocate
+        std::vector<std::vector<Value>> m_free;
         Interpreter *m_interp;
 
         Environment(Interpreter *interp)
@@ -37,11 +44,16 @@ namespace halo
         {
         }
 
-        void define(Token t, Object *o);
-        void assign(Token t, Object *o);
-        Object *get(Token t);
-        std::pair<std::unordered_map<std::string, Object *>::iterator, bool> lookup(Token t);
-        void add_scope(ScopeType st);
+        // the value of a slot whose variable has not been defined yet
+        static Value undefined();
+        static bool is_undefined(const Value &v);
+
+        void define(const Token &t, Value v, const Location &loc = Location());
+        void assign(const Token &t, Value v, const Location &loc);
+        Value get(const Token &t, const Location &loc);
+        // stores into a slot of the innermost scope whether its variable is defined or not, as a loop variable is
+        void store(const Location &loc, Value v);
+        void add_scope(ScopeType st, size_t size = 0);
         void remove_scope();
         void swap_env(Environment &other);
         void mark();
@@ -5,11 +5,27 @@
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace halo
 {
     class ExprVisitor;
 
+    // where the resolver found a variable: m_slot in the scope m_depth levels up from the innermost one,
+    // names that are not resolved to a local scope are looked up in the global scope by name
+    struct Location
+    {
+        static constexpr size_t global = SIZE_MAX;
+
+        size_t m_depth = global;
+        size_t m_slot = 0;
+
+        bool is_global() const
+        {
+            return m_depth == global;
+        }
+    };
+
     struct Expr
     {
         size_t m_line;
@@ -23,7 +39,7 @@ namespace halo
         {
         }
 
-        virtual Object *visit(ExprVisitor *v) = 0;
+        virtual Value visit(ExprVisitor *v) = 0;
     };
 
     struct Grouping : Expr
@@ -35,7 +51,7 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct BinaryExpr : Expr
@@ -49,7 +65,7 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct LogicalExpr : Expr
@@ -63,7 +79,7 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct UnaryExpr : Expr
@@ -76,33 +92,36 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Call : Expr
     {
         Expr *m_expr;
         std::vector<Expr *> m_args;
+        // of a method call
+        MethodCache m_method_cache;
 
         Call(Expr *e, const std::vector<Expr *> &a, size_t line)
             : Expr(line), m_expr(e), m_args(a)
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Dot : Expr
     {
         Expr *m_expr;
         Token m_name;
+        FieldCache m_cache;
 
         Dot(Expr *e, Token t, size_t line)
             : Expr(line), m_expr(e), m_name(t)
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Subscript : Expr
@@ -115,32 +134,33 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Literal : Expr
     {
         Token m_token;
-        Object *m_val;
+        Value m_val;
 
         Literal(Token t, size_t line)
-            : Expr(line), m_token(t), m_val(nullptr)
+            : Expr(line), m_token(t)
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Var : Expr
     {
         Token m_token;
+        Location m_loc;
 
         Var(Token t, size_t line)
             : Expr(line), m_token(t)
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct Stmt;
@@ -151,9 +171,17 @@ namespace halo
         std::vector<Token> m_params;
         std::vector<std::unique_ptr<Stmt>> m_body;
 
+        // captured values are looked up at m_capture_locs when the lambda is created,
+        // parameters live in a scope of m_params_size slots, captures and top level variables of the body in m_capture_size ones
+        std::vector<Location> m_capture_locs;
+        std::vector<size_t> m_capture_slots;
+        std::vector<size_t> m_param_slots;
+        size_t m_params_size = 0;
+        size_t m_capture_size = 0;
+
         Lambda(const std::vector<Token> &capture, const std::vector<Token> &params, std::vector<std::unique_ptr<Stmt>> body, size_t line);
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
     };
 
     struct ListExpr : Expr
@@ -165,21 +193,48 @@ namespace halo
         {
         }
 
-        Object *visit(ExprVisitor *v) override;
+        Value visit(ExprVisitor *v) override;
+    };
+
+    struct DictExpr : Expr
+    {
+        std::vector<Expr *> m_keys;
+        std::vector<Expr *> m_vals;
+
+        DictExpr(const std::vector<Expr *> &keys, const std::vector<Expr *> &vals, size_t line)
+            : Expr(line), m_keys(keys), m_vals(vals)
+        {
+        }
+
+        Value visit(ExprVisitor *v) override;
+    };
+
+    struct SetExpr : Expr
+    {
+        std::vector<Expr *> m_params;
+
+        SetExpr(const std::vector<Expr *> &params, size_t line)
+            : Expr(line), m_params(params)
+        {
+        }
+
+        Value visit(ExprVisitor *v) override;
     };
 
     struct ExprVisitor
     {
-        virtual Object *visit_grouping(Grouping *e) = 0;
-        virtual Object *visit_binary_expr(BinaryExpr *e) = 0;
-        virtual Object *visit_logical_expr(LogicalExpr *e) = 0;
-        virtual Object *visit_unary_expr(UnaryExpr *e) = 0;
-        virtual Object *visit_call_expr(Call *e) = 0;
-        virtual Object *visit_dot_expr(Dot *e) = 0;
-        virtual Object *visit_subscript_expr(Subscript *e) = 0;
-        virtual Object *visit_literal(Literal *e) = 0;
-        virtual Object *visit_var(Var *e) = 0;
-        virtual Object *visit_lambda(Lambda *e) = 0;
-        virtual Object *visit_list(ListExpr *e) = 0;
+        virtual Value visit_grouping(Grouping *e) = 0;
+        virtual Value visit_binary_expr(BinaryExpr *e) = 0;
+        virtual Value visit_logical_expr(LogicalExpr *e) = 0;
+        virtual Value visit_unary_expr(UnaryExpr *e) = 0;
+        virtual Value visit_call_expr(Call *e) = 0;
+        virtual Value visit_dot_expr(Dot *e) = 0;
+        virtual Value visit_subscript_expr(Subscript *e) = 0;
+        virtual Value visit_literal(Literal *e) = 0;
+        virtual Value visit_var(Var *e) = 0;
+        virtual Value visit_lambda(Lambda *e) = 0;
+        virtual Value visit_list(ListExpr *e) = 0;
+        virtual Value visit_dict(DictExpr *e) = 0;
+        virtual Value visit_set(SetExpr *e) = 0;
     };
 }
\ No newline at end of file
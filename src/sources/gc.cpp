@@ -1,34 +1,705 @@
 #include "gc.hpp"
 #include "interpreter.hpp"
+#include "vm.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 using namespace halo;
 using namespace std;
 
-void GC::collect()
+namespace
+{
+    // the mark stack of one marker thread; the part of it others may steal from is m_shared
+    struct MarkWorker
+    {
+        vector<Object *> m_local;
+        mutex m_mutex;
+        deque<Object *> m_shared;
+        atomic<size_t> m_shared_size{0};
+
+        void push(Object *o)
+        {
+            m_local.push_back(o);
+
+            if (m_local.size() > 64 && m_shared_size.load(memory_order_relaxed) == 0)
+            {
+                share();
+            }
+        }
+
+        void share()
+        {
+            lock_guard<mutex> lock(m_mutex);
+
+            size_t half = m_local.size() / 2;
+            m_shared.insert(m_shared.end(), m_local.begin(), m_local.begin() + half);
+            m_local.erase(m_local.begin(), m_local.begin() + half);
+            m_shared_size.store(m_shared.size(), memory_order_relaxed);
+        }
+
+        // takes half of the shared work of victim, which may be this worker itself
+        bool steal(MarkWorker &victim)
+        {
+            if (victim.m_shared_size.load(memory_order_relaxed) == 0)
+            {
+                return false;
+            }
+
+            lock_guard<mutex> lock(victim.m_mutex);
+
+            size_t n = (victim.m_shared.size() + 1) / 2;
+            m_local.insert(m_local.end(), victim.m_shared.begin(), victim.m_shared.begin() + n);
+            victim.m_shared.erase(victim.m_shared.begin(), victim.m_shared.begin() + n);
+            victim.m_shared_size.store(victim.m_shared.size(), memory_order_relaxed);
+
+            return n > 0;
+        }
+    };
+
+    thread_local MarkWorker *t_worker = nullptr;
+
+    void run_marker(vector<MarkWorker> &workers, size_t id, atomic<size_t> &active)
+    {
+        MarkWorker &me = workers[id];
+        t_worker = &me;
+
+        auto steal_any = [&]
+        {
+            for (size_t k = 0; k < workers.size(); ++k)
+            {
+                if (me.steal(workers[(id + k) % workers.size()]))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        while (true)
+        {
+            while (!me.m_local.empty())
+            {
+                Object *o = me.m_local.back();
+                me.m_local.pop_back();
+                o->trace();
+            }
+
+            if (steal_any())
+            {
+                continue;
+            }
+
+            // the marking is over when no thread is busy and nothing is left to steal
+            active.fetch_sub(1);
+
+            bool found = false;
+
+            while (!found)
+            {
+                for (auto &w : workers)
+                {
+                    if (w.m_shared_size.load(memory_order_relaxed) > 0)
+                    {
+                        active.fetch_add(1);
+                        found = steal_any();
+
+                        if (!found)
+                        {
+                            active.fetch_sub(1);
+                        }
+
+                        break;
+                    }
+                }
+
+                if (!found && active.load() == 0)
+                {
+                    t_worker = nullptr;
+                    return;
+                }
+
+                if (!found)
+                {
+                    this_thread::yield();
+                }
+            }
+        }
+    }
+}
+
+void GCStats::add_pause(double ms)
+{
+    m_total_pause += ms;
+    m_max_pause = max(m_max_pause, ms);
+
+    size_t bucket = upper_bound(pause_buckets.begin(), pause_buckets.end(), ms) - pause_buckets.begin();
+    ++m_pauses[bucket];
+}
+
+const char *GCStats::type_name(size_t tag)
+{
+#define HALO_OBJECT_TYPE_NAME(name) #name,
+
+    static const char *names[object_type_count] = {HALO_OBJECT_TYPES(HALO_OBJECT_TYPE_NAME, HALO_OBJECT_TYPE_NAME, HALO_OBJECT_TYPE_NAME)};
+    return names[tag];
+
+#undef HALO_OBJECT_TYPE_NAME
+}
+
+namespace
+{
+    // adds the time from its construction to its destruction to the pause statistics
+    struct PauseTimer
+    {
+        GCStats &m_stats;
+        chrono::steady_clock::time_point m_start;
+
+        PauseTimer(GCStats &stats)
+            : m_stats(stats), m_start(chrono::steady_clock::now())
+        {
+        }
+
+        ~PauseTimer()
+        {
+            m_stats.add_pause(chrono::duration<double, milli>(chrono::steady_clock::now() - m_start).count());
+        }
+    };
+
+    // sets *dst to the value of the environment variable name, if it is a valid one
+    void read_env(const char *name, size_t &dst)
+    {
+        const char *val = getenv(name);
+        char *end = nullptr;
+
+        if (val && *val)
+        {
+            long long res = strtoll(val, &end, 10);
+
+            if (*end == '\0' && res > 0)
+            {
+                dst = res;
+            }
+        }
+    }
+
+    void read_env(const char *name, double &dst)
+    {
+        const char *val = getenv(name);
+        char *end = nullptr;
+
+        if (val && *val)
+        {
+            double res = strtod(val, &end);
+
+            if (*end == '\0' && res >= 1)
+            {
+                dst = res;
+            }
+        }
+    }
+}
+
+GC::GC()
+{
+    configure_from_env();
+}
+
+void GC::configure_from_env()
+{
+    read_env("HALO_GC_HEAP_SIZE", m_threshold);
+    read_env("HALO_GC_GROWTH", m_growth);
+    read_env("HALO_GC_NURSERY_SIZE", m_nursery_size);
+    read_env("HALO_GC_STEP_BUDGET", m_step_budget);
+    read_env("HALO_GC_THREADS", m_threads);
+}
+
+void GC::count_allocation()
+{
+    // outside of any context, such as the constants made by the compiler, no line allocates
+    if (!m_interp->m_context)
+    {
+        return;
+    }
+
+    // the VM brings the lines of the contexts up to date only on demand
+    if (m_interp->m_vm)
+    {
+        m_interp->m_vm->sync_debug_info();
+    }
+
+    m_counters->count_allocation(m_interp->get_curr_error_line());
+}
+
+void GC::destroy(Object *o)
+{
+#define HALO_POOL_DESTROY(name)                          \
+    case ObjectType::name:                               \
+        count_freed(o->m_tag, 1, sizeof(name));          \
+        m_##name##_pool.destroy(static_cast<name *>(o)); \
+        break;
+
+    switch (o->m_tag)
+    {
+        HALO_OBJECT_TYPES(HALO_POOL_NONE, HALO_POOL_NONE, HALO_POOL_DESTROY)
+    default:
+        count_freed(o->m_tag, 1, static_cast<Callable *>(o)->m_size);
+        delete o;
+        break;
+    }
+
+#undef HALO_POOL_DESTROY
+}
+
+void GC::count_freed(ObjectType tag, size_t objects, size_t bytes)
+{
+    m_stats.m_freed_objects[static_cast<size_t>(tag)] += objects;
+    m_stats.m_freed_bytes[static_cast<size_t>(tag)] += bytes;
+}
+
+void GC::mark_roots()
 {
     m_interp->get_env().mark();
 
-    for (auto e : m_interp->m_tmp_vals)
+    if (m_interp->m_vm)
+    {
+        m_interp->m_vm->mark();
+    }
+
+    for (auto &v : m_interp->m_tmp_vals)
+    {
+        v.mark();
+    }
+
+    m_interp->m_return_value.mark();
+}
+
+void GC::trace_young()
+{
+    mark_roots();
+
+    for (auto o : m_remembered)
+    {
+        shade(o);
+        o->m_remembered = false;
+    }
+
+    m_remembered.clear();
+
+    while (!m_young_gray.empty())
+    {
+        Object *o = m_young_gray.back();
+        m_young_gray.pop_back();
+        o->trace();
+    }
+}
+
+void GC::promote_nursery()
+{
+    m_stats.m_nursery_collected += m_nursery.size();
+
+    for (auto o : m_nursery)
+    {
+        if (is_marked(o) || o->m_eternal)
+        {
+            ++m_stats.m_promoted;
+
+            // stays marked for as long as it is old, its children are marked already
+            o->m_marked.store(m_epoch, memory_order_relaxed);
+            o->m_old = true;
+            ++m_old_count;
+
+            if (o->m_tag == ObjectType::Callable)
+            {
+                m_old.push_back(o);
+            }
+        }
+        else
+        {
+            destroy(o);
+        }
+    }
+
+    m_nursery.clear();
+}
+
+void GC::collect_minor()
+{
+    PauseTimer timer(m_stats);
+    ++m_stats.m_minor_collections;
+
+    trace_young();
+    promote_nursery();
+
+    if (m_phase == Phase::Idle && m_old_count >= m_threshold)
+    {
+        start_major();
+
+        if (m_threads > 1)
+        {
+            finish_major();
+            return;
+        }
+    }
+
+    if (m_phase == Phase::Marking)
+    {
+        mark_step(m_step_budget);
+
+        if (m_gray.empty() && !m_partial)
+        {
+            start_sweep();
+        }
+    }
+    else if (m_phase == Phase::Sweeping)
+    {
+        sweep_step(m_step_budget);
+    }
+}
+
+void GC::start_major()
+{
+    // the nursery is empty here, so every object becomes white
+    m_epoch = !m_epoch;
+    m_phase = Phase::Marking;
+
+    mark_roots();
+}
+
+// marks and sweeps what is left of the current major cycle at once
+void GC::finish_major()
+{
+    if (m_phase == Phase::Marking)
+    {
+        if (m_threads > 1)
+        {
+            parallel_mark();
+        }
+        else
+        {
+            mark_step(numeric_limits<size_t>::max());
+        }
+
+        start_sweep();
+    }
+
+    if (m_threads > 1)
+    {
+        parallel_sweep();
+    }
+    else
+    {
+        sweep_step(numeric_limits<size_t>::max());
+    }
+}
+
+void GC::mark_step(size_t budget)
+{
+    while (budget > 0)
+    {
+        if (m_partial)
+        {
+            auto &vals = m_partial->m_vals;
+            size_t end = vals.size();
+
+            if (m_partial_pos < end && end - m_partial_pos > budget)
+            {
+                end = m_partial_pos + budget;
+            }
+
+            for (; m_partial_pos < end; ++m_partial_pos, --budget)
+            {
+                vals[m_partial_pos].mark();
+            }
+
+            // the list may also have shrunk since the last step
+            if (m_partial_pos >= vals.size())
+            {
+                m_partial = nullptr;
+            }
+
+            continue;
+        }
+
+        if (m_gray.empty())
+        {
+            return;
+        }
+
+        Object *o = m_gray.back();
+        m_gray.pop_back();
+        --budget;
+
+        // lists are traced a slice at a time, so a long one does not make a long pause
+        if (o->m_tag == ObjectType::List)
+        {
+            m_partial = static_cast<List *>(o);
+            m_partial_pos = 0;
+            continue;
+        }
+
+        o->trace();
+    }
+}
+
+// runs f(0), ..., f(m_threads - 1) each on its own thread, f(0) on the calling one
+void GC::run_parallel(const function<void(size_t)> &f)
+{
+    if (m_workers.size() != m_threads - 1)
+    {
+        m_workers.resize(m_threads - 1);
+    }
+
+    m_workers.run(f);
+}
+
+void GC::parallel_mark()
+{
+    vector<MarkWorker> workers(m_threads);
+
+    // a list traced partly is gray, so it is traced again from the start
+    if (m_partial)
+    {
+        m_gray.push_back(m_partial);
+        m_partial = nullptr;
+    }
+
+    for (size_t i = 0; i < m_gray.size(); ++i)
+    {
+        workers[i % m_threads].m_shared.push_back(m_gray[i]);
+    }
+
+    for (auto &w : workers)
+    {
+        w.m_shared_size.store(w.m_shared.size());
+    }
+
+    m_gray.clear();
+
+    atomic<size_t> active(m_threads);
+
+    m_parallel = true;
+    run_parallel([&](size_t id)
+                 { run_marker(workers, id, active); });
+    m_parallel = false;
+}
+
+void GC::shade_parallel(Object *o)
+{
+    if (o->m_marked.load(memory_order_relaxed) == m_epoch || o->m_marked.exchange(m_epoch, memory_order_relaxed) == m_epoch)
+    {
+        return;
+    }
+
+    t_worker->push(o);
+}
+
+bool GC::survives(Object *o)
+{
+    // young objects are left to promote_nursery()
+    if (!o->m_old)
+    {
+        return true;
+    }
+
+    if (is_marked(o) || o->m_eternal)
     {
-        if (!e->m_marked)
+        o->m_marked.store(m_epoch, memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void GC::start_sweep()
+{
+    m_phase = Phase::Sweeping;
+    m_sweep_pool = 0;
+    m_sweep_page = 0;
+
+    size_t alive = 0;
+
+    for (auto o : m_old)
+    {
+        if (survives(o))
         {
-            e->mark();
+            m_old[alive++] = o;
+        }
+        else
+        {
+            --m_old_count;
+            count_freed(o->m_tag, 1, static_cast<Callable *>(o)->m_size);
+            delete o;
         }
     }
 
-    for (auto it = m_objects.begin(); it != m_objects.end();)
+    m_old.resize(alive);
+}
+
+void GC::end_sweep()
+{
+    m_phase = Phase::Idle;
+    ++m_stats.m_major_collections;
+
+    m_threshold = max(m_threshold, size_t(m_growth * m_old_count));
+}
+
+template <typename T>
+bool GC::sweep_pool(Pool<T> &pool, ObjectType tag, size_t &budget)
+{
+    for (; m_sweep_page < pool.page_count(); ++m_sweep_page)
     {
-        if ((*it)->m_marked || (*it)->m_eternal)
+        if (budget == 0)
         {
-            (*it)->m_marked = false;
-            ++it;
+            return false;
+        }
+
+        budget -= min(budget, pool.slots_per_page());
+
+        auto chain = pool.sweep_pages(m_sweep_page, m_sweep_page + 1, [this](T *o)
+                                      { return survives(o); });
+        m_old_count -= chain.m_count;
+        count_freed(tag, chain.m_count, chain.m_count * sizeof(T));
+        pool.add_free(chain);
+    }
+
+    m_sweep_page = 0;
+    return true;
+}
+
+void GC::sweep_step(size_t budget)
+{
+    size_t pool_index = 0;
+
+    // objects promoted while sweeping are marked, so they survive
+    bool done = for_each_pool([&](auto &pool, ObjectType tag)
+                              {
+                                  // the pools before m_sweep_pool are swept already
+                                  if (pool_index++ < m_sweep_pool)
+                                  {
+                                      return true;
+                                  }
+
+                                  if (!sweep_pool(pool, tag, budget))
+                                  {
+                                      return false;
+                                  }
+
+                                  ++m_sweep_pool;
+                                  return true; });
+
+    if (done)
+    {
+        end_sweep();
+    }
+}
+
+template <typename T>
+void GC::parallel_sweep_pool(Pool<T> &pool, ObjectType tag, size_t first_page)
+{
+    size_t pages = pool.page_count() - min(first_page, pool.page_count());
+
+    if (pages == 0)
+    {
+        return;
+    }
+
+    vector<typename Pool<T>::FreeChain> chains(m_threads);
+
+    run_parallel([&](size_t id)
+                 {
+                     size_t begin = first_page + pages * id / m_threads;
+                     size_t end = first_page + pages * (id + 1) / m_threads;
+                     chains[id] = pool.sweep_pages(begin, end, [this](T *o)
+                                                   { return survives(o); }); });
+
+    for (auto &chain : chains)
+    {
+        m_old_count -= chain.m_count;
+        count_freed(tag, chain.m_count, chain.m_count * sizeof(T));
+        pool.add_free(chain);
+    }
+}
+
+void GC::parallel_sweep()
+{
+    size_t pool_index = 0;
+
+    // the pools before m_sweep_pool and the pages of it before m_sweep_page are swept already
+    for_each_pool([&](auto &pool, ObjectType tag)
+                  {
+                      if (pool_index >= m_sweep_pool)
+                      {
+                          parallel_sweep_pool(pool, tag, pool_index == m_sweep_pool ? m_sweep_page : 0);
+                      }
+
+                      ++pool_index;
+                      return true; });
+
+    end_sweep();
+}
+
+void GC::collect()
+{
+    PauseTimer timer(m_stats);
+
+    trace_young();
+    promote_nursery();
+
+    // objects that died while the current cycle was marking survive it,
+    // so it is finished first and a fresh one is run
+    if (m_phase != Phase::Idle)
+    {
+        finish_major();
+    }
+
+    start_major();
+    finish_major();
+}
+
+void GC::print_stats(ostream &out) const
+{
+    out << "GC statistics\n"
+        << "    minor collections: " << m_stats.m_minor_collections << "\n"
+        << "    major collections: " << m_stats.m_major_collections << "\n"
+        << "    total pause: " << m_stats.m_total_pause << " ms\n"
+        << "    max pause: " << m_stats.m_max_pause << " ms\n"
+        << "    pauses:\n";
+
+    for (size_t i = 0; i < m_stats.m_pauses.size(); ++i)
+    {
+        if (i < GCStats::pause_buckets.size())
+        {
+            out << "        < " << GCStats::pause_buckets[i] << " ms: ";
         }
         else
         {
-            delete *it;
-            it = m_objects.erase(it);
+            out << "        >= " << GCStats::pause_buckets.back() << " ms: ";
         }
+
+        out << m_stats.m_pauses[i] << "\n";
+    }
+
+    out << "    survivor ratio: " << m_stats.survivor_ratio() << "\n"
+        << "    objects: " << count() << "\n"
+        << "    allocated / freed:\n";
+
+    for (size_t i = 0; i < object_type_count; ++i)
+    {
+        if (m_stats.m_allocated_objects[i] == 0)
+        {
+            continue;
+        }
+
+        out << "        " << GCStats::type_name(i) << ": "
+            << m_stats.m_allocated_objects[i] << " (" << m_stats.m_allocated_bytes[i] << " bytes) / "
+            << m_stats.m_freed_objects[i] << " (" << m_stats.m_freed_bytes[i] << " bytes)\n";
     }
 }
\ No newline at end of file
@@ -1,37 +1,195 @@
 #pragma once
 
-#include <list>
+#include <array>
+#include <vector>
 
 #include "object.hpp"
+#include "pool.hpp"
+#include "workers.hpp"
 
 namespace halo
 {
     class Interpreter;
+    class Counters;
 
-    enum class ObjectType
+    struct GCStats
     {
-        Object,
-        Int,
-        Float,
-        Bool,
-        String,
-        StringIter,
-        Callable,
-        List,
-        ListIter,
-        Null
+        // the upper bounds of the pause histogram buckets in milliseconds, the last bucket has none
+        static constexpr std::array<double, 6> pause_buckets = {0.1, 0.5, 1, 5, 10, 50};
+
+        size_t m_minor_collections = 0;
+        size_t m_major_collections = 0;
+        double m_total_pause = 0;
+        double m_max_pause = 0;
+        std::array<size_t, pause_buckets.size() + 1> m_pauses{};
+
+        // indexed by ObjectType
+        std::array<size_t, object_type_count> m_allocated_objects{};
+        std::array<size_t, object_type_count> m_allocated_bytes{};
+        std::array<size_t, object_type_count> m_freed_objects{};
+        std::array<size_t, object_type_count> m_freed_bytes{};
+
+        // young objects that survived a minor collection, out of all collected by one
+        size_t m_promoted = 0;
+        size_t m_nursery_collected = 0;
+
+        double survivor_ratio() const
+        {
+            return m_nursery_collected ? double(m_promoted) / m_nursery_collected : 0;
+        }
+
+        void add_pause(double ms);
+
+        static const char *type_name(size_t tag);
     };
 
+    // generational collector: new objects go to the nursery, which is collected
+    // on its own (minor collection) when it is full; survivors are promoted to the
+    // old generation, which is only collected (major collection) when it grows past m_threshold
+    //
+    // marking is tri-color: a marked object is gray while it is on a worklist and black
+    // once it is traced; tracing is iterative, so deep structures do not grow the C++ stack
+    //
+    // old objects stay marked outside of a major cycle, so a minor collection stops at them;
+    // young objects stored into old ones since the last collection are kept
+    // in the remembered set by write_barrier() and are treated as roots, so a minor
+    // collection does not need to trace the (possibly long) old object that refers to them
+    //
+    // a major cycle starts by flipping m_epoch, which turns every old object white at once,
+    // and then marks the old generation incrementally, m_step_budget references per minor collection;
+    // during marking write_barrier() shades every old object stored into another object,
+    // and every minor collection shades the roots again, so marking is over
+    // at the first minor collection that finds the gray worklist empty
+    //
+    // every fixed-size object type lives in a pool, whose pages are then swept
+    // incrementally as well, m_step_budget slots per minor collection;
+    // callables are allocated by new, kept in m_old and swept at once
+    //
+    // with m_threads > 1 a major cycle is not incremental: it is marked by that many threads,
+    // which trace from per-thread stacks and steal work from each other, and then swept in parallel
     class GC
     {
-        std::list<Object *> m_objects;
+#define HALO_POOL_NONE(name)
+#define HALO_POOL_MEMBER(name) Pool<name> m_##name##_pool;
+
+        // a pool for each POOLED object type, such as m_String_pool
+        HALO_OBJECT_TYPES(HALO_POOL_NONE, HALO_POOL_NONE, HALO_POOL_MEMBER)
+
+#undef HALO_POOL_MEMBER
+
+        static constexpr size_t pool_count = 0 HALO_OBJECT_TYPES(HALO_POOL_NONE, HALO_POOL_NONE, HALO_OBJECT_TYPE_ONE);
+
+        // new_object() allocates only pooled objects and callables, and destroy()
+        // deletes every object that is not in a pool as a callable
+        static_assert(pool_count + 1 == object_type_count - static_cast<size_t>(ObjectType::Object),
+                      "every object type but the unboxed ones and Callable must be pooled");
+
+        std::vector<Object *> m_nursery;
+        std::vector<Object *> m_old;
+        std::vector<Object *> m_remembered;
+        std::vector<Object *> m_gray;
+        std::vector<Object *> m_young_gray;
+        size_t m_old_count = 0;
         Interpreter *m_interp;
+        // counts the allocations of each line while set
+        Counters *m_counters = nullptr;
+        size_t m_nursery_size = 1024;
         size_t m_threshold = 100;
+        size_t m_step_budget = 4096;
+        size_t m_threads = 1;
+        double m_growth = 2;
+        bool m_epoch = true;
+        // shade() runs on the marker threads
+        bool m_parallel = false;
+
+        enum class Phase
+        {
+            Idle,
+            Marking,
+            Sweeping
+        };
+
+        Phase m_phase = Phase::Idle;
+
+        // a long list being traced a slice at a time, it is gray until it is done
+        List *m_partial = nullptr;
+        size_t m_partial_pos = 0;
+
+        // the next page to sweep, m_sweep_pool counts the pools in the order of for_each_pool()
+        size_t m_sweep_pool = 0;
+        size_t m_sweep_page = 0;
+
+        GCStats m_stats;
+
+        // the threads that mark and sweep along with the calling one when m_threads > 1,
+        // started by the first such cycle and kept for the next ones
+        Workers m_workers;
+
+        GC();
+
+        void configure_from_env();
+
+        Object *track(Object *o, size_t bytes)
+        {
+            if (m_nursery.size() >= m_nursery_size)
+            {
+                collect_minor();
+            }
+
+            o->m_marked.store(!m_epoch, std::memory_order_relaxed);
+            m_nursery.push_back(o);
+
+            size_t tag = static_cast<size_t>(o->m_tag);
+            ++m_stats.m_allocated_objects[tag];
+            m_stats.m_allocated_bytes[tag] += bytes;
+
+            if (m_counters)
+            {
+                count_allocation();
+            }
+
+            return o;
+        }
+
+        void count_allocation();
+        void destroy(Object *o);
+        void count_freed(ObjectType tag, size_t objects, size_t bytes);
 
-        GC()
+        void mark_roots();
+        void trace_young();
+        void promote_nursery();
+        void collect_minor();
+
+        void start_major();
+        void finish_major();
+        void mark_step(size_t budget);
+        void run_parallel(const std::function<void(size_t)> &f);
+        void parallel_mark();
+        void shade_parallel(Object *o);
+
+        void start_sweep();
+        void end_sweep();
+        void sweep_step(size_t budget);
+        void parallel_sweep();
+        bool survives(Object *o);
+
+        // calls f(pool, tag) for every pool, in the order they are swept, until f returns false
+        template <typename F>
+        bool for_each_pool(F f)
         {
+#define HALO_POOL_VISIT(name) f(m_##name##_pool, ObjectType::name) &&
+
+            return HALO_OBJECT_TYPES(HALO_POOL_NONE, HALO_POOL_NONE, HALO_POOL_VISIT) true;
+
+#undef HALO_POOL_VISIT
         }
 
+        template <typename T>
+        bool sweep_pool(Pool<T> &pool, ObjectType tag, size_t &budget);
+
+        template <typename T>
+        void parallel_sweep_pool(Pool<T> &pool, ObjectType tag, size_t first_page);
+
     public:
         static GC &instance()
         {
@@ -44,6 +202,11 @@ namespace halo
             m_interp = interp;
         }
 
+        void set_counters(Counters *counters)
+        {
+            m_counters = counters;
+        }
+
         Interpreter *get_interp()
         {
             return m_interp;
@@ -51,7 +214,16 @@ namespace halo
 
         ~GC()
         {
-            for (auto e : m_objects)
+            // pooled objects are destroyed by their pools
+            for (auto e : m_nursery)
+            {
+                if (e->m_tag == ObjectType::Callable)
+                {
+                    delete e;
+                }
+            }
+
+            for (auto e : m_old)
             {
                 delete e;
             }
@@ -60,79 +232,166 @@ namespace halo
         template <typename T>
         Object *new_object()
         {
-            if (count() >= m_threshold)
+            T *o = new T();
+            o->m_size = sizeof(T);
+            return track(o, sizeof(T));
+        }
+
+        Object *new_object(ObjectType t, Object *o = nullptr)
+        {
+#define HALO_POOL_CREATE(name) \
+    case ObjectType::name:      \
+        return track(m_##name##_pool.create(), sizeof(name));
+
+            switch (t)
             {
-                collect();
+                HALO_OBJECT_TYPES(HALO_POOL_NONE, HALO_POOL_NONE, HALO_POOL_CREATE)
+            case ObjectType::Callable:
+                return track(o, static_cast<Callable *>(o)->m_size);
+            default:
+                return nullptr;
+            }
 
-                if (m_threshold < count())
-                {
-                    m_threshold = 2 * count();
-                }
+#undef HALO_POOL_CREATE
+        }
+
+        bool is_marked(const Object *o) const
+        {
+            return o->m_marked.load(std::memory_order_relaxed) == m_epoch;
+        }
+
+        // turns a white object gray
+        void shade(Object *o)
+        {
+            if (m_parallel)
+            {
+                shade_parallel(o);
+                return;
+            }
+
+            if (is_marked(o))
+            {
+                return;
             }
 
-            m_objects.push_back(new T());
-            return m_objects.back();
+            o->m_marked.store(m_epoch, std::memory_order_relaxed);
+            (o->m_old ? m_gray : m_young_gray).push_back(o);
         }
 
-        Object *new_object(ObjectType t, Object *o = nullptr)
+        // must be called after a reference to val is stored into the existing object owner
+        void write_barrier(Object *owner, const Value &val)
         {
-            if (count() >= m_threshold)
+            if (!val.is_object())
             {
-                collect();
+                return;
+            }
 
-                if (m_threshold < count())
+            if (val.m_obj->m_old)
+            {
+                if (m_phase == Phase::Marking)
                 {
-                    m_threshold = 2 * count();
+                    shade(val.m_obj);
                 }
             }
+            else if (owner->m_old && !val.m_obj->m_remembered)
+            {
+                val.m_obj->m_remembered = true;
+                m_remembered.push_back(val.m_obj);
+            }
+        }
 
-            switch (t)
+        // must be called when the element at index is removed from list and the ones after it move down:
+        // if the list is being traced a slice at a time, the element moved to the position the tracing
+        // has reached would be skipped, so the position moves down with it
+        void list_erased(List *list, size_t index)
+        {
+            if (list == m_partial && index < m_partial_pos)
             {
-            case ObjectType::Object:
-                m_objects.push_back(new Object());
-                return m_objects.back();
-            case ObjectType::Int:
-                m_objects.push_back(new Int());
-                return m_objects.back();
-            case ObjectType::Float:
-                m_objects.push_back(new Float());
-                return m_objects.back();
-            case ObjectType::Bool:
-                m_objects.push_back(new Bool());
-                return m_objects.back();
-            case ObjectType::String:
-                m_objects.push_back(new String());
-                return m_objects.back();
-            case ObjectType::StringIter:
-                m_objects.push_back(new StringIter());
-                return m_objects.back();
-            case ObjectType::List:
-                m_objects.push_back(new List());
-                return m_objects.back();
-            case ObjectType::ListIter:
-                m_objects.push_back(new ListIter());
-                return m_objects.back();
-            case ObjectType::Callable:
-                m_objects.push_back(o);
-                return m_objects.back();
-            case ObjectType::Null:
-                m_objects.push_back(new Null());
-                return m_objects.back();
-            default:
-                return nullptr;
+                --m_partial_pos;
             }
         }
 
+        // full collection of both generations
         void collect();
 
         size_t count() const
         {
-            return m_objects.size();
+            return m_nursery.size() + m_old_count;
         }
 
         size_t get_treshold()
         {
             return m_threshold;
         }
+
+        // the number of objects allocated between minor collections
+        void set_nursery_size(size_t objects)
+        {
+            m_nursery_size = objects ? objects : 1;
+        }
+
+        size_t get_nursery_size() const
+        {
+            return m_nursery_size;
+        }
+
+        // the number of references a major cycle traces, or pool slots it sweeps, per minor collection
+        void set_step_budget(size_t budget)
+        {
+            m_step_budget = budget ? budget : 1;
+        }
+
+        size_t get_step_budget() const
+        {
+            return m_step_budget;
+        }
+
+        // the size of the old generation, in objects, at which the first major cycle starts
+        void set_heap_size(size_t objects)
+        {
+            m_threshold = objects ? objects : 1;
+        }
+
+        // after a major cycle the next one starts when the old generation is growth times larger
+        void set_growth(double growth)
+        {
+            m_growth = growth > 1 ? growth : 1;
+        }
+
+        double get_growth() const
+        {
+            return m_growth;
+        }
+
+        const GCStats &get_stats() const
+        {
+            return m_stats;
+        }
+
+        void print_stats(std::ostream &out) const;
+
+        // the number of threads that mark and sweep the old generation
+        void set_threads(size_t threads)
+        {
+            m_threads = threads ? threads : 1;
+
+            if (m_workers.size() > 0)
+            {
+                m_workers.resize(m_threads - 1);
+            }
+        }
+
+        size_t get_threads() const
+        {
+            return m_threads;
+        }
     };
+
+    inline void Value::mark() const
+    {
+        if (is_object())
+        {
+            GC::instance().shade(m_obj);
+        }
+    }
 }
@@ -1,4 +1,5 @@
-#include "Interpreter.hpp"
+#include "interpreter.hpp"
+#include "vm.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -9,19 +10,82 @@
 using namespace std;
 using namespace halo;
 
+namespace
+{
+    const Token my_token(TokenType::Var, "my", 0, 0);
+
+    const Symbol init_symbol = intern("_init_");
+    const Symbol iter_symbol = intern("_iter_");
+    const Symbol has_next_symbol = intern("_has_next_");
+    const Symbol next_symbol = intern("_next_");
+
+    const vector<Value> no_args;
+
+    // the iterators of the builtin types are called directly rather than by the names of the protocol
+    NativeMethod native_has_next(ObjectType tag)
+    {
+        switch (tag)
+        {
+        case ObjectType::StringIter:
+            return StringIter::has_next;
+        case ObjectType::ListIter:
+            return ListIter::has_next;
+        case ObjectType::DictIter:
+            return DictIter::has_next;
+        case ObjectType::SetIter:
+            return SetIter::has_next;
+        case ObjectType::ArrayIter:
+            return ArrayIter::has_next;
+        case ObjectType::RangeIter:
+            return RangeIter::has_next;
+        default:
+            return nullptr;
+        }
+    }
+
+    NativeMethod native_next(ObjectType tag)
+    {
+        switch (tag)
+        {
+        case ObjectType::StringIter:
+            return StringIter::next;
+        case ObjectType::ListIter:
+            return ListIter::next;
+        case ObjectType::DictIter:
+            return DictIter::next;
+        case ObjectType::SetIter:
+            return SetIter::next;
+        case ObjectType::ArrayIter:
+            return ArrayIter::next;
+        case ObjectType::RangeIter:
+            return RangeIter::next;
+        default:
+            return nullptr;
+        }
+    }
+}
+
+// the resolver gives a block that declares no variables the size 0, such a block runs in the enclosing scope
 struct Scope
 {
     Environment &m_env;
+    bool m_entered;
 
-    Scope(Environment &env, Environment::ScopeType st)
-        : m_env(env)
+    Scope(Environment &env, Environment::ScopeType st, size_t size)
+        : m_env(env), m_entered(size != 0)
     {
-        m_env.add_scope(st);
+        if (m_entered)
+        {
+            m_env.add_scope(st, size);
+        }
     }
 
     ~Scope()
     {
-        m_env.remove_scope();
+        if (m_entered)
+        {
+            m_env.remove_scope();
+        }
     }
 };
 
@@ -29,10 +93,10 @@ struct FunScope
 {
     Environment &m_env;
 
-    FunScope(Environment &env, Environment::ScopeType st)
+    FunScope(Environment &env, Environment::ScopeType st, size_t size)
         : m_env(env)
     {
-        m_env.add_scope(st);
+        m_env.add_scope(st, size);
     }
 
     ~FunScope()
@@ -56,54 +120,32 @@ struct StackTmpManager
     }
 };
 
-struct BreakSignal
-{
-    // empty
-};
-
-struct ContinueSignal
-{
-    // empty
-};
-
-struct ReturnSignal
-{
-    Object *m_res;
-
-    ReturnSignal(Object *res)
-        : m_res(res)
-    {
-    }
-};
-
 struct Function : Callable
 {
     Interpreter *m_interp = nullptr;
     FunStmt *m_fst = nullptr;
+    Chunk *m_chunk = nullptr;
     string m_class_name;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun);
+        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun, m_fst->m_scope_size);
         m_interp->inc_fun_scope_counter();
 
-        for (size_t i = 0; i < args.size(); ++i)
+        if (Counters *counters = m_interp->get_counters())
         {
-            m_interp->get_env().define(m_fst->m_params[i], args[i]);
+            counters->count_call(m_fst);
         }
 
-        try
-        {
-            m_interp->execute(m_fst->m_body);
-        }
-        catch (const ReturnSignal &rs)
+        for (size_t i = 0; i < args.size(); ++i)
         {
-            m_interp->dec_fun_scope_counter();
-            return rs.m_res;
+            m_interp->get_env().define(m_fst->m_params[i], args[i], Location{0, m_fst->m_param_slots[i]});
         }
 
+        Value res = m_interp->run_body(m_fst->m_body, m_chunk);
+
         m_interp->dec_fun_scope_counter();
-        return nullptr;
+        return res;
     }
 
     int arity() const override
@@ -126,34 +168,46 @@ struct LambdaFunction : Callable
 {
     Interpreter *m_interp = nullptr;
     Lambda *m_l = nullptr;
-    std::unordered_map<std::string, Object *> m_capture;
+    Chunk *m_chunk = nullptr;
+    std::vector<Value> m_capture;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        FunScope fc(m_interp->get_env(), Environment::ScopeType::Lambda);
+        FunScope fc(m_interp->get_env(), Environment::ScopeType::Lambda, m_l->m_params_size);
         m_interp->inc_fun_scope_counter();
+
+        if (Counters *counters = m_interp->get_counters())
+        {
+            counters->count_call(m_l);
+        }
+
         for (size_t i = 0; i < args.size(); ++i)
         {
-            m_interp->get_env().define(m_l->m_params[i], args[i]);
+            m_interp->get_env().define(m_l->m_params[i], args[i], Location{0, m_l->m_param_slots[i]});
         }
 
-        FunScope fc2(m_interp->get_env(), Environment::ScopeType::Capture);
-        m_interp->get_env().m_data.back() = move(m_capture);
+        FunScope fc2(m_interp->get_env(), Environment::ScopeType::Capture, m_l->m_capture_size);
 
-        try
+        // a recursive call finds the captures already moved out and starts with an empty scope
+        if (!m_capture.empty())
         {
-            m_interp->execute(m_l->m_body);
+            m_interp->get_env().m_data.back() = move(m_capture);
+            m_capture.clear();
         }
-        catch (const ReturnSignal &rs)
+
+        Value res = m_interp->run_body(m_l->m_body, m_chunk);
+
+        m_capture = move(m_interp->get_env().m_data.back());
+
+        // the body may have assigned new objects to the captured variables
+        for (auto &val : m_capture)
         {
-            m_capture = move(m_interp->get_env().m_data.back());
-            m_interp->dec_fun_scope_counter();
-            return rs.m_res;
+            GC::instance().write_barrier(this, val);
         }
-        m_capture = move(m_interp->get_env().m_data.back());
+
         m_interp->dec_fun_scope_counter();
 
-        return nullptr;
+        return res;
     }
 
     int arity() const override
@@ -171,15 +225,13 @@ struct LambdaFunction : Callable
         return "<lambda>(" + to_string(arity()) + ")";
     }
 
-    void mark() override
+    void trace() override
     {
-        m_marked = true;
-
-        for (auto &[str, obj] : m_capture)
+        for (auto &val : m_capture)
         {
-            if (obj && !obj->m_marked)
+            if (!Environment::is_undefined(val))
             {
-                obj->mark();
+                val.mark();
             }
         }
     }
@@ -189,19 +241,17 @@ struct Class : ClassBase
 {
     Interpreter *m_interp = nullptr;
     ClassStmt *m_cst = nullptr;
-    unordered_map<string, Function *> m_methods;
+    unordered_map<Symbol, Function *> m_methods;
+    // in the order of m_cst->m_methods, which numbers them for the call site caches
+    vector<Function *> m_method_list;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
         auto my = GC::instance().new_object(ObjectType::Object);
         my->m_type = this;
+        my->set_shape(&m_cst->m_shape);
 
-        for (auto &f : m_cst->m_fields)
-        {
-            my->m_fields.emplace(f, nullptr);
-        }
-
-        auto it = m_methods.find("_init_");
+        auto it = m_methods.find(init_symbol);
 
         if (it == m_methods.end())
         {
@@ -210,66 +260,85 @@ struct Class : ClassBase
 
         Function *init = it->second;
 
-        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun); // fun _init_
+        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun, init->m_fst->m_scope_size); // fun _init_
         m_interp->inc_fun_scope_counter();
 
-        m_interp->get_env().define(Token(TokenType::Var, "my", 0, 0), my);
-
-        for (size_t i = 0; i < args.size(); ++i)
+        if (Counters *counters = m_interp->get_counters())
         {
-            m_interp->get_env().define(init->m_fst->m_params[i], args[i]);
+            counters->count_call(init->m_fst);
         }
 
-        try
-        {
-            m_interp->execute(init->m_fst->m_body);
-        }
-        catch (const ReturnSignal &rs)
+        m_interp->get_env().define(my_token, my, Location{0, 0});
+
+        for (size_t i = 0; i < args.size(); ++i)
         {
-            m_interp->dec_fun_scope_counter();
-            return my;
+            m_interp->get_env().define(init->m_fst->m_params[i], args[i], Location{0, init->m_fst->m_param_slots[i]});
         }
 
+        m_interp->run_body(init->m_fst->m_body, init->m_chunk);
+
         m_interp->dec_fun_scope_counter();
         return my;
     }
 
-    Object *call_method(Object *my, const std::string &name, const std::vector<Object *> &args) override
+    Value call_method(Object *my, Symbol name, const std::vector<Value> &args) override
     {
-        auto it = m_methods.find(name);
-        Function *method = it->second;
-
-        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun);
-        m_interp->inc_fun_scope_counter();
-
-        m_interp->get_env().define(Token(TokenType::Var, "my", 0, 0), my);
+        return run_method(my, m_methods.find(name)->second, args);
+    }
 
-        for (size_t i = 0; i < args.size(); ++i)
+    size_t find_method(Symbol name) const override
+    {
+        for (size_t i = 0; i < m_method_list.size(); ++i)
         {
-            m_interp->get_env().define(method->m_fst->m_params[i], args[i]);
+            if (m_method_list[i]->m_fst->m_name.symbol() == name)
+            {
+                return i;
+            }
         }
 
-        try
+        return no_method;
+    }
+
+    size_t method_arity(size_t index) const override
+    {
+        return m_method_list[index]->arity();
+    }
+
+    Value call_method_at(Object *my, size_t index, const std::vector<Value> &args) override
+    {
+        return run_method(my, m_method_list[index], args);
+    }
+
+    Value run_method(Object *my, Function *method, const std::vector<Value> &args)
+    {
+        FunScope fc(m_interp->get_env(), Environment::ScopeType::Fun, method->m_fst->m_scope_size);
+        m_interp->inc_fun_scope_counter();
+
+        if (Counters *counters = m_interp->get_counters())
         {
-            m_interp->execute(method->m_fst->m_body);
+            counters->count_call(method->m_fst);
         }
-        catch (const ReturnSignal &rs)
+
+        m_interp->get_env().define(my_token, my, Location{0, 0});
+
+        for (size_t i = 0; i < args.size(); ++i)
         {
-            m_interp->dec_fun_scope_counter();
-            return rs.m_res;
+            m_interp->get_env().define(method->m_fst->m_params[i], args[i], Location{0, method->m_fst->m_param_slots[i]});
         }
 
+        Value res = m_interp->run_body(method->m_fst->m_body, method->m_chunk);
+
         m_interp->dec_fun_scope_counter();
-        return nullptr;
+        return res;
     }
 
-    void check_method(const std::string &name, const std::vector<Object *> &args) override
+    void check_method(Symbol name, const std::vector<Value> &args) override
     {
         auto it = m_methods.find(name);
 
         if (it == m_methods.end())
         {
-            throw runtime_error(m_interp->report_error("name '" + name + "' is not defined"));
+            throw runtime_error(m_interp->report_error("name '" + *name + "' is not defined"));
         }
 
         Function *method = it->second;
@@ -287,7 +356,7 @@ struct Class : ClassBase
 
     int arity() const override
     {
-        auto it = m_methods.find("_init_");
+        auto it = m_methods.find(init_symbol);
         if (it == m_methods.end())
         {
             return 0;
@@ -316,7 +385,7 @@ struct Class : ClassBase
         vector<string> vs;
         for (const auto &[name, fn] : m_methods)
         {
-            vs.push_back(name);
+            vs.push_back(*name);
         }
 
         sort(vs.begin(), vs.end());
@@ -332,15 +401,13 @@ struct Class : ClassBase
         return res;
     }
 
-    void mark() override
+    void trace() override
     {
-        m_marked = true;
-
         for (auto &[str, obj] : m_methods)
         {
-            if (obj && !obj->m_marked)
+            if (obj)
             {
-                obj->mark();
+                GC::instance().shade(obj);
             }
         }
     }
@@ -350,9 +417,9 @@ struct PrintLine : Callable
 {
     Interpreter *interp = nullptr;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        interp->get_out() << (!args.front() ? "null"s : args.front()->to_str()) << endl;
+        interp->get_out() << args.front().to_str() << endl;
         return nullptr;
     }
 
@@ -376,9 +443,9 @@ struct Print : Callable
 {
     Interpreter *interp = nullptr;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        interp->get_out() << (!args.front() ? "null"s : args.front()->to_str());
+        interp->get_out() << args.front().to_str();
         return nullptr;
     }
 
@@ -402,13 +469,13 @@ struct ReadLine : Callable
 {
     Interpreter *interp = nullptr;
 
-    Object *call([[maybe_unused]] const std::vector<Object *> &args) override
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
     {
         string str;
         getline(interp->get_in(), str);
         Object *res = GC::instance().new_object(ObjectType::String);
         GC::instance().get_interp()->get_tmp_vals().push_back(res);
-        dynamic_cast<String *>(res)->m_val = str;
+        static_cast<String *>(res)->m_val = str;
 
         return res;
     }
@@ -431,21 +498,16 @@ struct ReadLine : Callable
 
 struct ToInt : Callable
 {
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        Object *res = GC::instance().new_object(ObjectType::Int);
-        GC::instance().get_interp()->get_tmp_vals().push_back(res);
-
         try
         {
-            dynamic_cast<Int *>(res)->m_val = stoll(args.front()->to_str());
+            return Value::integer(stoll(args.front().to_str()));
         }
         catch (const std::exception &)
         {
             throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in fun 'to_int'"));
         }
-
-        return res;
     }
 
     int arity() const override
@@ -466,21 +528,16 @@ struct ToInt : Callable
 
 struct ToFloat : Callable
 {
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        Object *res = GC::instance().new_object(ObjectType::Float);
-        GC::instance().get_interp()->get_tmp_vals().push_back(res);
-
         try
         {
-            dynamic_cast<Float *>(res)->m_val = stod(args.front()->to_str());
+            return Value::floating(stod(args.front().to_str()));
         }
         catch (const std::exception &)
         {
             throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in fun 'to_float'"));
         }
-
-        return res;
     }
 
     int arity() const override
@@ -501,14 +558,14 @@ struct ToFloat : Callable
 
 struct ToStr : Callable
 {
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
         Object *res = GC::instance().new_object(ObjectType::String);
         GC::instance().get_interp()->get_tmp_vals().push_back(res);
 
         try
         {
-            dynamic_cast<String *>(res)->m_val = args.front()->to_str();
+            static_cast<String *>(res)->m_val = args.front().to_str();
         }
         catch (const std::exception &)
         {
@@ -534,11 +591,88 @@ struct ToStr : Callable
     }
 };
 
+// creates an empty object of a builtin type
+struct NewObject : Callable
+{
+    ObjectType m_new_tag = ObjectType::Null;
+    const char *m_name = "";
+
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
+    {
+        return GC::instance().new_object(m_new_tag);
+    }
+
+    int arity() const override
+    {
+        return 0;
+    }
+
+    string to_str() const override
+    {
+        return m_name;
+    }
+
+    string debug_info() const override
+    {
+        return m_name;
+    }
+};
+
+// creates an IntArray or a FloatArray of the given size or from a list
+struct NewArray : Callable
+{
+    ObjectType m_new_tag = ObjectType::Null;
+
+    Value call(const std::vector<Value> &args) override
+    {
+        return m_new_tag == ObjectType::IntArray ? IntArray::create(args.front()) : FloatArray::create(args.front());
+    }
+
+    int arity() const override
+    {
+        return 1;
+    }
+
+    string to_str() const override
+    {
+        return m_new_tag == ObjectType::IntArray ? IntArray::type_name() : FloatArray::type_name();
+    }
+
+    string debug_info() const override
+    {
+        return to_str();
+    }
+};
+
+// creates a range, which is iterated like a range loop without being stored as a list
+struct NewRange : Callable
+{
+    Value call(const std::vector<Value> &args) override
+    {
+        return Range::create(args[0], args[1], args[2]);
+    }
+
+    int arity() const override
+    {
+        return 3;
+    }
+
+    string to_str() const override
+    {
+        return "range";
+    }
+
+    string debug_info() const override
+    {
+        return to_str();
+    }
+};
+
 struct GetRecursionDepth : Callable
 {
     Interpreter *m_interp = nullptr;
 
-    Object *call([[maybe_unused]] const std::vector<Object *> &args) override
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
     {
         m_interp->get_out() << m_interp->get_recursion_depth() << endl;
         return nullptr;
@@ -564,13 +698,15 @@ struct SetRecursionDepth : Callable
 {
     Interpreter *m_interp = nullptr;
 
-    Object *call(const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        if (auto depth = dynamic_cast<Int *>(args.front()))
+        if (tag_of(args.front()) == ObjectType::Int)
         {
-            if (depth->m_val > 0)
+            long long depth = args.front().m_int;
+
+            if (depth > 0)
             {
-                m_interp->set_recursion_depth(depth->m_val);
+                m_interp->set_recursion_depth(depth);
                 return nullptr;
             }
 
@@ -600,7 +736,7 @@ struct PrintGCInfo : Callable
 {
     Interpreter *m_interp = nullptr;
 
-    Object *call([[maybe_unused]] const std::vector<Object *> &args) override
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
     {
         m_interp->get_out() << "Objects in GC: " << GC::instance().count() << endl;
         m_interp->get_out() << "Threshold: " << GC::instance().get_treshold() << endl;
@@ -627,7 +763,7 @@ struct PrintGCInfo : Callable
 
 struct GCCollect : Callable
 {
-    Object *call([[maybe_unused]] const std::vector<Object *> &args) override
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
     {
         GC::instance().collect();
         return nullptr;
@@ -649,18 +785,49 @@ struct GCCollect : Callable
     }
 };
 
-struct Error : Callable
+struct GetGCThreads : Callable
+{
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
+    {
+        return Value::integer(GC::instance().get_threads());
+    }
+
+    int arity() const override
+    {
+        return 0;
+    }
+
+    string to_str() const override
+    {
+        return "get_gc_threads";
+    }
+
+    string debug_info() const override
+    {
+        return "get_gc_threads";
+    }
+};
+
+struct SetGCThreads : Callable
 {
     Interpreter *m_interp = nullptr;
 
-    Object *call([[maybe_unused]] const std::vector<Object *> &args) override
+    Value call(const std::vector<Value> &args) override
     {
-        if (auto msg = dynamic_cast<String *>(args.front()))
+        if (tag_of(args.front()) == ObjectType::Int)
         {
-            throw runtime_error(m_interp->report_error(msg->m_val));
+            long long threads = args.front().m_int;
+
+            if (threads > 0 && threads <= 256)
+            {
+                GC::instance().set_threads(threads);
+                return nullptr;
+            }
+
+            throw runtime_error(m_interp->report_error("invalid number of threads in fun 'set_gc_threads'"));
         }
 
-        throw runtime_error(m_interp->report_error("invalid argument type in fun 'error'"));
+        throw runtime_error(m_interp->report_error("invalid argument type in fun 'set_gc_threads'"));
     }
 
     int arity() const override
@@ -670,82 +837,380 @@ struct Error : Callable
 
     string to_str() const override
     {
-        return "error";
+        return "set_gc_threads";
     }
 
     string debug_info() const override
     {
-        return "error";
+        return "set_gc_threads";
     }
 };
 
-Interpreter::Interpreter(istream &in, ostream &out)
-    : m_env(this), m_in(in), m_out(out), m_fun_scope_counter(0), m_max_fun_depth(1024), m_script("cli")
+struct SetGCHeapSize : Callable
 {
-    GC::instance().set_interp(this);
+    Interpreter *m_interp = nullptr;
 
-    m_env.add_scope(Environment::ScopeType::Global);
+    Value call(const std::vector<Value> &args) override
+    {
+        if (tag_of(args.front()) == ObjectType::Int)
+        {
+            long long objects = args.front().m_int;
 
-    PrintLine *pl = dynamic_cast<PrintLine *>(GC::instance().new_object<PrintLine>());
-    pl->interp = this;
-    m_env.define(Token(TokenType::Var, "println", 0, 0), pl);
+            if (objects > 0)
+            {
+                GC::instance().set_heap_size(objects);
+                return nullptr;
+            }
 
-    Print *p = dynamic_cast<Print *>(GC::instance().new_object<Print>());
-    p->interp = this;
-    m_env.define(Token(TokenType::Var, "print", 0, 0), p);
+            throw runtime_error(m_interp->report_error("invalid heap size in fun 'set_gc_heap_size'"));
+        }
 
-    ReadLine *rl = dynamic_cast<ReadLine *>(GC::instance().new_object<ReadLine>());
-    rl->interp = this;
-    m_env.define(Token(TokenType::Var, "readln", 0, 0), rl);
+        throw runtime_error(m_interp->report_error("invalid argument type in fun 'set_gc_heap_size'"));
+    }
 
-    GetRecursionDepth *grd = dynamic_cast<GetRecursionDepth *>(GC::instance().new_object<GetRecursionDepth>());
-    grd->m_interp = this;
-    m_env.define(Token(TokenType::Var, "get_recursion_depth", 0, 0), grd);
+    int arity() const override
+    {
+        return 1;
+    }
 
-    SetRecursionDepth *srd = dynamic_cast<SetRecursionDepth *>(GC::instance().new_object<SetRecursionDepth>());
-    srd->m_interp = this;
-    m_env.define(Token(TokenType::Var, "set_recursion_depth", 0, 0), srd);
+    string to_str() const override
+    {
+        return "set_gc_heap_size";
+    }
 
-    PrintGCInfo *pgci = dynamic_cast<PrintGCInfo *>(GC::instance().new_object<PrintGCInfo>());
-    pgci->m_interp = this;
-    m_env.define(Token(TokenType::Var, "print_gc_info", 0, 0), pgci);
+    string debug_info() const override
+    {
+        return "set_gc_heap_size";
+    }
+};
 
-    Error *err = dynamic_cast<Error *>(GC::instance().new_object<Error>());
-    err->m_interp = this;
-    m_env.define(Token(TokenType::Var, "error", 0, 0), err);
+struct SetGCGrowth : Callable
+{
+    Interpreter *m_interp = nullptr;
 
-    m_env.define(Token(TokenType::Var, "to_int", 0, 0), GC::instance().new_object<ToInt>());
-    m_env.define(Token(TokenType::Var, "to_float", 0, 0), GC::instance().new_object<ToFloat>());
-    m_env.define(Token(TokenType::Var, "to_str", 0, 0), GC::instance().new_object<ToStr>());
+    Value call(const std::vector<Value> &args) override
+    {
+        const Value &arg = args.front();
 
-    m_env.define(Token(TokenType::Var, "gc_collect", 0, 0), GC::instance().new_object<GCCollect>());
-}
+        if (tag_of(arg) == ObjectType::Int || tag_of(arg) == ObjectType::Float)
+        {
+            double growth = tag_of(arg) == ObjectType::Int ? arg.m_int : arg.m_float;
 
-void Interpreter::interpret(Expr *e)
-{
-    Object *res = (e == nullptr) ? nullptr : evaluate(e);
+            if (growth >= 1)
+            {
+                GC::instance().set_growth(growth);
+                return nullptr;
+            }
 
-    cout << (res != nullptr ? res->to_str() : "null") << endl;
-}
+            throw runtime_error(m_interp->report_error("invalid growth factor in fun 'set_gc_growth'"));
+        }
 
-Object *Interpreter::evaluate_whole_expr(Expr *e)
-{
-    StackTmpManager stm(m_tmp_vals.size());
-    return evaluate(e);
-}
+        throw runtime_error(m_interp->report_error("invalid argument type in fun 'set_gc_growth'"));
+    }
 
-Object *Interpreter::evaluate(Expr *e)
-{
-    Object *res = e->visit(this);
-    m_tmp_vals.push_back(res);
-    return res;
-}
+    int arity() const override
+    {
+        return 1;
+    }
 
-void Interpreter::execute(const std::vector<unique_ptr<Stmt>> &stmts)
-{
-    for (auto &stmt : stmts)
+    string to_str() const override
     {
-        execute_stmt(stmt.get());
+        return "set_gc_growth";
+    }
+
+    string debug_info() const override
+    {
+        return "set_gc_growth";
+    }
+};
+
+// the type of the plain objects native functions return, they have fields only
+struct Record : ClassBase
+{
+    Interpreter *m_interp = nullptr;
+    string m_name;
+    Shape m_shape;
+
+    Value call_method([[maybe_unused]] Object *my, Symbol name, [[maybe_unused]] const std::vector<Value> &args) override
+    {
+        throw runtime_error(m_interp->report_error("undefined method '" + *name + "' in class " + get_name()));
+    }
+
+    void check_method(Symbol name, [[maybe_unused]] const std::vector<Value> &args) override
+    {
+        throw runtime_error(m_interp->report_error("name '" + *name + "' is not defined in class " + get_name()));
+    }
+
+    std::string get_name() const override
+    {
+        return m_name;
+    }
+
+    string to_str() const override
+    {
+        return "<class " + m_name + ">";
+    }
+
+    Object *create()
+    {
+        Object *o = GC::instance().new_object(ObjectType::Object);
+        o->m_type = this;
+        o->set_shape(&m_shape);
+        m_interp->get_tmp_vals().push_back(o);
+        return o;
+    }
+};
+
+struct GetGCStats : Callable
+{
+    Interpreter *m_interp = nullptr;
+    Record *m_stats_type = nullptr;
+    Record *m_type_stats_type = nullptr;
+
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
+    {
+        const GCStats &st = GC::instance().get_stats();
+
+        Object *res = m_stats_type->create();
+
+        size_t allocated_objects = 0;
+        size_t allocated_bytes = 0;
+        size_t freed_objects = 0;
+        size_t freed_bytes = 0;
+
+        List *types = static_cast<List *>(GC::instance().new_object(ObjectType::List));
+        res->set_field(intern("types"), types);
+
+        for (size_t i = 0; i < object_type_count; ++i)
+        {
+            if (st.m_allocated_objects[i] == 0)
+            {
+                continue;
+            }
+
+            Object *t = m_type_stats_type->create();
+            types->m_vals.push_back(t);
+            GC::instance().write_barrier(types, t);
+
+            String *name = static_cast<String *>(GC::instance().new_object(ObjectType::String));
+            name->m_val = GCStats::type_name(i);
+            t->set_field(intern("name"), name);
+
+            t->set_field(intern("allocated_objects"), Value::integer(st.m_allocated_objects[i]));
+            t->set_field(intern("allocated_bytes"), Value::integer(st.m_allocated_bytes[i]));
+            t->set_field(intern("freed_objects"), Value::integer(st.m_freed_objects[i]));
+            t->set_field(intern("freed_bytes"), Value::integer(st.m_freed_bytes[i]));
+
+            allocated_objects += st.m_allocated_objects[i];
+            allocated_bytes += st.m_allocated_bytes[i];
+            freed_objects += st.m_freed_objects[i];
+            freed_bytes += st.m_freed_bytes[i];
+        }
+
+        // the pause counts by bucket, see GCStats::pause_buckets
+        List *pauses = static_cast<List *>(GC::instance().new_object(ObjectType::List));
+        res->set_field(intern("pauses"), pauses);
+
+        for (size_t n : st.m_pauses)
+        {
+            pauses->m_vals.push_back(Value::integer(n));
+        }
+
+        res->set_field(intern("minor_collections"), Value::integer(st.m_minor_collections));
+        res->set_field(intern("major_collections"), Value::integer(st.m_major_collections));
+        res->set_field(intern("total_pause_ms"), Value::floating(st.m_total_pause));
+        res->set_field(intern("max_pause_ms"), Value::floating(st.m_max_pause));
+        res->set_field(intern("survivor_ratio"), Value::floating(st.survivor_ratio()));
+        res->set_field(intern("allocated_objects"), Value::integer(allocated_objects));
+        res->set_field(intern("allocated_bytes"), Value::integer(allocated_bytes));
+        res->set_field(intern("freed_objects"), Value::integer(freed_objects));
+        res->set_field(intern("freed_bytes"), Value::integer(freed_bytes));
+        res->set_field(intern("objects"), Value::integer(GC::instance().count()));
+        res->set_field(intern("heap_size"), Value::integer(GC::instance().get_treshold()));
+        res->set_field(intern("growth"), Value::floating(GC::instance().get_growth()));
+
+        return res;
+    }
+
+    int arity() const override
+    {
+        return 0;
+    }
+
+    string to_str() const override
+    {
+        return "gc_stats";
+    }
+
+    string debug_info() const override
+    {
+        return "gc_stats";
+    }
+};
+
+struct Error : Callable
+{
+    Interpreter *m_interp = nullptr;
+
+    Value call([[maybe_unused]] const std::vector<Value> &args) override
+    {
+        if (tag_of(args.front()) == ObjectType::String)
+        {
+            throw runtime_error(m_interp->report_error(args.front().to_str()));
+        }
+
+        throw runtime_error(m_interp->report_error("invalid argument type in fun 'error'"));
+    }
+
+    int arity() const override
+    {
+        return 1;
+    }
+
+    string to_str() const override
+    {
+        return "error";
+    }
+
+    string debug_info() const override
+    {
+        return "error";
+    }
+};
+
+Interpreter::Interpreter(istream &in, ostream &out)
+    : m_env(this), m_in(in), m_out(out), m_fun_scope_counter(0), m_max_fun_depth(1024), m_script("cli"), m_vm(nullptr)
+{
+    GC::instance().set_interp(this);
+
+    m_env.add_scope(Environment::ScopeType::Global);
+
+    PrintLine *pl = static_cast<PrintLine *>(GC::instance().new_object<PrintLine>());
+    pl->interp = this;
+    m_env.define(Token(TokenType::Var, "println", 0, 0), pl);
+
+    Print *p = static_cast<Print *>(GC::instance().new_object<Print>());
+    p->interp = this;
+    m_env.define(Token(TokenType::Var, "print", 0, 0), p);
+
+    ReadLine *rl = static_cast<ReadLine *>(GC::instance().new_object<ReadLine>());
+    rl->interp = this;
+    m_env.define(Token(TokenType::Var, "readln", 0, 0), rl);
+
+    GetRecursionDepth *grd = static_cast<GetRecursionDepth *>(GC::instance().new_object<GetRecursionDepth>());
+    grd->m_interp = this;
+    m_env.define(Token(TokenType::Var, "get_recursion_depth", 0, 0), grd);
+
+    SetRecursionDepth *srd = static_cast<SetRecursionDepth *>(GC::instance().new_object<SetRecursionDepth>());
+    srd->m_interp = this;
+    m_env.define(Token(TokenType::Var, "set_recursion_depth", 0, 0), srd);
+
+    PrintGCInfo *pgci = static_cast<PrintGCInfo *>(GC::instance().new_object<PrintGCInfo>());
+    pgci->m_interp = this;
+    m_env.define(Token(TokenType::Var, "print_gc_info", 0, 0), pgci);
+
+    Error *err = static_cast<Error *>(GC::instance().new_object<Error>());
+    err->m_interp = this;
+    m_env.define(Token(TokenType::Var, "error", 0, 0), err);
+
+    m_env.define(Token(TokenType::Var, "to_int", 0, 0), GC::instance().new_object<ToInt>());
+    m_env.define(Token(TokenType::Var, "to_float", 0, 0), GC::instance().new_object<ToFloat>());
+    m_env.define(Token(TokenType::Var, "to_str", 0, 0), GC::instance().new_object<ToStr>());
+
+    NewObject *nsb = static_cast<NewObject *>(GC::instance().new_object<NewObject>());
+    nsb->m_new_tag = ObjectType::StringBuilder;
+    nsb->m_name = "StringBuilder";
+    m_env.define(Token(TokenType::Var, "StringBuilder", 0, 0), nsb);
+
+    NewObject *nd = static_cast<NewObject *>(GC::instance().new_object<NewObject>());
+    nd->m_new_tag = ObjectType::Dict;
+    nd->m_name = "Dict";
+    m_env.define(Token(TokenType::Var, "Dict", 0, 0), nd);
+
+    NewObject *ns = static_cast<NewObject *>(GC::instance().new_object<NewObject>());
+    ns->m_new_tag = ObjectType::Set;
+    ns->m_name = "Set";
+    m_env.define(Token(TokenType::Var, "Set", 0, 0), ns);
+
+    NewArray *nia = static_cast<NewArray *>(GC::instance().new_object<NewArray>());
+    nia->m_new_tag = ObjectType::IntArray;
+    m_env.define(Token(TokenType::Var, "IntArray", 0, 0), nia);
+
+    NewArray *nfa = static_cast<NewArray *>(GC::instance().new_object<NewArray>());
+    nfa->m_new_tag = ObjectType::FloatArray;
+    m_env.define(Token(TokenType::Var, "FloatArray", 0, 0), nfa);
+
+    m_env.define(Token(TokenType::Var, "range", 0, 0), GC::instance().new_object<NewRange>());
+
+    m_env.define(Token(TokenType::Var, "gc_collect", 0, 0), GC::instance().new_object<GCCollect>());
+    m_env.define(Token(TokenType::Var, "get_gc_threads", 0, 0), GC::instance().new_object<GetGCThreads>());
+
+    SetGCThreads *sgt = static_cast<SetGCThreads *>(GC::instance().new_object<SetGCThreads>());
+    sgt->m_interp = this;
+    m_env.define(Token(TokenType::Var, "set_gc_threads", 0, 0), sgt);
+
+    SetGCHeapSize *sghs = static_cast<SetGCHeapSize *>(GC::instance().new_object<SetGCHeapSize>());
+    sghs->m_interp = this;
+    m_env.define(Token(TokenType::Var, "set_gc_heap_size", 0, 0), sghs);
+
+    SetGCGrowth *sgg = static_cast<SetGCGrowth *>(GC::instance().new_object<SetGCGrowth>());
+    sgg->m_interp = this;
+    m_env.define(Token(TokenType::Var, "set_gc_growth", 0, 0), sgg);
+
+    GetGCStats *ggs = static_cast<GetGCStats *>(GC::instance().new_object<GetGCStats>());
+    ggs->m_interp = this;
+    m_env.define(Token(TokenType::Var, "gc_stats", 0, 0), ggs);
+
+    // the instances do not keep their type alive, so the types are eternal
+    ggs->m_stats_type = static_cast<Record *>(GC::instance().new_object<Record>());
+    ggs->m_stats_type->m_interp = this;
+    ggs->m_stats_type->m_name = "GCStats";
+    ggs->m_stats_type->m_shape = Shape({"types", "pauses", "minor_collections", "major_collections", "total_pause_ms", "max_pause_ms", "survivor_ratio",
+                                        "allocated_objects", "allocated_bytes", "freed_objects", "freed_bytes", "objects", "heap_size", "growth"});
+    ggs->m_stats_type->m_eternal = true;
+
+    ggs->m_type_stats_type = static_cast<Record *>(GC::instance().new_object<Record>());
+    ggs->m_type_stats_type->m_interp = this;
+    ggs->m_type_stats_type->m_name = "GCTypeStats";
+    ggs->m_type_stats_type->m_shape = Shape({"name", "allocated_objects", "allocated_bytes", "freed_objects", "freed_bytes"});
+    ggs->m_type_stats_type->m_eternal = true;
+}
+
+void Interpreter::interpret(Expr *e)
+{
+    Value res = (e == nullptr) ? Value() : evaluate(e);
+
+    cout << res.to_str() << endl;
+}
+
+Value Interpreter::evaluate_whole_expr(Expr *e)
+{
+    StackTmpManager stm(m_tmp_vals.size());
+    return evaluate(e);
+}
+
+Value Interpreter::evaluate(Expr *e)
+{
+    Value res = e->visit(this);
+
+    if (res.is_object())
+    {
+        m_tmp_vals.push_back(res);
+    }
+
+    return res;
+}
+
+void Interpreter::execute(const std::vector<unique_ptr<Stmt>> &stmts)
+{
+    for (auto &stmt : stmts)
+    {
+        execute_stmt(stmt.get());
+
+        if (m_completion != Completion::Normal)
+        {
+            return;
+        }
     }
 
     // test purpose
@@ -757,183 +1222,203 @@ void Interpreter::execute(const std::vector<unique_ptr<Stmt>> &stmts)
 
 void Interpreter::execute_stmt(Stmt *stmt)
 {
+    if (m_counters)
+    {
+        m_counters->count_line(stmt->m_line);
+    }
+
     stmt->visit(this);
 }
 
-Object *Interpreter::visit_grouping(Grouping *e)
+Value Interpreter::run_body(const std::vector<std::unique_ptr<Stmt>> &body, Chunk *chunk)
+{
+    if (chunk)
+    {
+        return m_vm->run(chunk);
+    }
+
+    execute(body);
+
+    if (m_completion == Completion::Return)
+    {
+        m_completion = Completion::Normal;
+        Value res = m_return_value;
+        m_return_value = Value();
+        return res;
+    }
+
+    return nullptr;
+}
+
+bool Interpreter::end_iteration()
+{
+    switch (m_completion)
+    {
+    case Completion::Normal:
+        return true;
+    case Completion::Continue:
+        m_completion = Completion::Normal;
+        return true;
+    case Completion::Break:
+        m_completion = Completion::Normal;
+        return false;
+    default:
+        // a return leaves the loop with the completion set for run_body()
+        return false;
+    }
+}
+
+Value Interpreter::visit_grouping(Grouping *e)
 {
     return evaluate(e);
 }
 
-Object *Interpreter::visit_binary_expr(BinaryExpr *e)
+Value Interpreter::visit_binary_expr(BinaryExpr *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "binary expression";
+    ContextManager cm(this, e->m_line, NodeKind::BinaryExpr);
 
-    Object *o1 = evaluate(e->m_left);
-    Object *o2 = evaluate(e->m_right);
+    Value v1 = evaluate(e->m_left);
+    Value v2 = evaluate(e->m_right);
 
-    switch (e->m_token.m_type)
+    return binary_op(e->m_token, v1, v2);
+}
+
+namespace
+{
+    template <ObjectType Tag>
+    auto unbox(const Value &v)
     {
-    case TokenType::Plus:
-        if (Object *res = bin_op<Int, ObjectType::Int>(o1, o2, plus<long long>()))
+        if constexpr (Tag == ObjectType::Int)
         {
-            return res;
+            return v.m_int;
         }
-        if (Object *res = bin_op<Float, ObjectType::Float>(o1, o2, plus<double>()))
+        else
         {
-            return res;
+            return static_cast<double>(v.m_tag == ObjectType::Int ? v.m_int : v.m_float);
         }
-        if (Object *res = bin_op<String, ObjectType::String>(o1, o2, plus<string>()))
+    }
+
+    template <ObjectType Tag, typename T>
+    Value box(T val)
+    {
+        if constexpr (Tag == ObjectType::Int)
         {
-            return res;
+            return Value::integer(val);
         }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Float>(o1, o2, plus<double>()))
+        else if constexpr (Tag == ObjectType::Float)
         {
-            return res;
+            return Value::floating(val);
         }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
-    case TokenType::Minus:
-        if (Object *res = bin_op<Int, ObjectType::Int>(o1, o2, minus<long long>()))
+        else
         {
-            return res;
+            return Value::boolean(val);
         }
-        if (Object *res = bin_op<Float, ObjectType::Float>(o1, o2, minus<double>()))
+    }
+
+    // Int operands are converted to double if the other operand is a Float
+    template <ObjectType Operands, ObjectType Res, typename Op>
+    Value bin_op(Value left, Value right)
+    {
+        return box<Res>(Op()(unbox<Operands>(left), unbox<Operands>(right)));
+    }
+
+    template <typename Op>
+    Value int_div_op(Value left, Value right)
+    {
+        if (right.m_int == 0)
         {
-            return res;
+            throw runtime_error(GC::instance().get_interp()->report_error("division by zero"));
         }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Float>(o1, o2, minus<double>()))
+
+        return Value::integer(Op()(left.m_int, right.m_int));
+    }
+
+    Value concat_op(Value left, Value right)
+    {
+        return String::concat(static_cast<String *>(left.m_obj), static_cast<String *>(right.m_obj));
+    }
+
+    // handlers of the typed binary operators indexed by the operator and the tags of both operands,
+    // a missing handler means the operand types are not supported
+    struct BinaryOpTable
+    {
+        using Handler = Value (*)(Value left, Value right);
+
+        static constexpr size_t op_count = static_cast<size_t>(TokenType::GreaterEqual) + 1;
+
+        Handler m_handlers[op_count][object_type_count][object_type_count] = {};
+
+        BinaryOpTable()
         {
-            return res;
+            add_numeric<plus, ObjectType::Int, ObjectType::Float>(TokenType::Plus);
+            add_numeric<minus, ObjectType::Int, ObjectType::Float>(TokenType::Minus);
+            add_numeric<multiplies, ObjectType::Int, ObjectType::Float>(TokenType::Mul);
+            add_numeric<divides, ObjectType::Int, ObjectType::Float>(TokenType::Div);
+            add_numeric<less, ObjectType::Bool, ObjectType::Bool>(TokenType::Less);
+            add_numeric<less_equal, ObjectType::Bool, ObjectType::Bool>(TokenType::LessEqual);
+            add_numeric<greater, ObjectType::Bool, ObjectType::Bool>(TokenType::Greater);
+            add_numeric<greater_equal, ObjectType::Bool, ObjectType::Bool>(TokenType::GreaterEqual);
+
+            set(TokenType::Div, ObjectType::Int, ObjectType::Int, int_div_op<divides<long long>>);
+            set(TokenType::Mod, ObjectType::Int, ObjectType::Int, int_div_op<modulus<long long>>);
+            set(TokenType::Plus, ObjectType::String, ObjectType::String, concat_op);
         }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
-    case TokenType::Mul:
-        if (Object *res = bin_op<Int, ObjectType::Int>(o1, o2, multiplies<long long>()))
+
+        void set(TokenType op, ObjectType left, ObjectType right, Handler h)
         {
-            return res;
+            m_handlers[static_cast<size_t>(op)][static_cast<size_t>(left)][static_cast<size_t>(right)] = h;
         }
-        if (Object *res = bin_op<Float, ObjectType::Float>(o1, o2, multiplies<double>()))
+
+        template <template <typename> class Op, ObjectType IntRes, ObjectType FloatRes>
+        void add_numeric(TokenType op)
         {
-            return res;
+            set(op, ObjectType::Int, ObjectType::Int, bin_op<ObjectType::Int, IntRes, Op<long long>>);
+            set(op, ObjectType::Float, ObjectType::Float, bin_op<ObjectType::Float, FloatRes, Op<double>>);
+            set(op, ObjectType::Float, ObjectType::Int, bin_op<ObjectType::Float, FloatRes, Op<double>>);
+            set(op, ObjectType::Int, ObjectType::Float, bin_op<ObjectType::Float, FloatRes, Op<double>>);
         }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Float>(o1, o2, multiplies<double>()))
+
+        Handler get(TokenType op, const Value &left, const Value &right) const
         {
-            return res;
+            return m_handlers[static_cast<size_t>(op)][static_cast<size_t>(left.m_tag)][static_cast<size_t>(right.m_tag)];
         }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
+    };
+
+    const BinaryOpTable binary_op_table;
+}
+
+Value Interpreter::binary_op(const Token &op, Value v1, Value v2)
+{
+    switch (op.m_type)
+    {
+    case TokenType::Plus:
+    case TokenType::Minus:
+    case TokenType::Mul:
     case TokenType::Div:
-        if (dynamic_cast<Int *>(o1))
-        {
-            if (Int *p_right = dynamic_cast<Int *>(o2))
-            {
-                if (p_right->m_val == 0)
-                {
-                    throw runtime_error(report_error("division by zero"));
-                }
-            }
-        }
-        if (Object *res = bin_op<Int, ObjectType::Int>(o1, o2, divides<long long>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op<Float, ObjectType::Float>(o1, o2, divides<double>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Float>(o1, o2, divides<double>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
     case TokenType::Mod:
-        if (Object *res = bin_op<Int, ObjectType::Int>(o1, o2, modulus<long long>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
     case TokenType::Less:
-        if (Object *res = bin_op<Int, ObjectType::Bool, Bool>(o1, o2, less<long long>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op<Float, ObjectType::Bool, Bool>(o1, o2, less<double>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Bool, Bool>(o1, o2, less<double>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
     case TokenType::LessEqual:
-        if (Object *res = bin_op<Int, ObjectType::Bool, Bool>(o1, o2, less_equal<long long>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op<Float, ObjectType::Bool, Bool>(o1, o2, less_equal<double>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Bool, Bool>(o1, o2, less_equal<double>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
     case TokenType::Greater:
-        if (Object *res = bin_op<Int, ObjectType::Bool, Bool>(o1, o2, greater<long long>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op<Float, ObjectType::Bool, Bool>(o1, o2, greater<double>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Bool, Bool>(o1, o2, greater<double>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
     case TokenType::GreaterEqual:
-        if (Object *res = bin_op<Int, ObjectType::Bool, Bool>(o1, o2, greater_equal<long long>()))
-        {
-            return res;
-        }
-        if (Object *res = bin_op<Float, ObjectType::Bool, Bool>(o1, o2, greater_equal<double>()))
+        if (auto handler = binary_op_table.get(op.m_type, v1, v2))
         {
-            return res;
+            return handler(v1, v2);
         }
-        if (Object *res = bin_op_conv<Float, Int, ObjectType::Bool, Bool>(o1, o2, greater_equal<double>()))
-        {
-            return res;
-        }
-        throw runtime_error(report_error("incorrect operand types for '" + e->m_token.m_lexeme + "' operator"));
+        throw runtime_error(report_error("incorrect operand types for '" + op.m_lexeme + "' operator"));
     case TokenType::EqualEqual:
-    {
-        Object *r = GC::instance().new_object(ObjectType::Bool);
-        GC::instance().get_interp()->get_tmp_vals().push_back(r);
-        static_cast<Bool *>(r)->m_val = equals(o1, o2);
-        return r;
-    }
+        return Value::boolean(v1.equals(v2));
     case TokenType::BangEqual:
-    {
-        Object *r = GC::instance().new_object(ObjectType::Bool);
-        GC::instance().get_interp()->get_tmp_vals().push_back(r);
-        static_cast<Bool *>(r)->m_val = !equals(o1, o2);
-        return r;
-    }
+        return Value::boolean(!v1.equals(v2));
     default:
-        throw runtime_error(report_error("unknown operator '" + e->m_token.m_lexeme + "'"));
+        throw runtime_error(report_error("unknown operator '" + op.m_lexeme + "'"));
     }
 }
 
-Object *Interpreter::visit_logical_expr(LogicalExpr *e)
+Value Interpreter::visit_logical_expr(LogicalExpr *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "logical expression";
+    ContextManager cm(this, e->m_line, NodeKind::LogicalExpr);
 
-    Object *left = evaluate(e->m_left);
+    Value left = evaluate(e->m_left);
 
     if (e->m_token.m_type == TokenType::Or && is_true(left))
     {
@@ -948,89 +1433,67 @@ Object *Interpreter::visit_logical_expr(LogicalExpr *e)
     return evaluate(e->m_right);
 }
 
-Object *Interpreter::visit_unary_expr(UnaryExpr *e)
+Value Interpreter::visit_unary_expr(UnaryExpr *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "unary expression";
+    ContextManager cm(this, e->m_line, NodeKind::UnaryExpr);
 
-    Object *o = evaluate(e->m_expr);
+    Value v = evaluate(e->m_expr);
 
-    switch (e->m_token.m_type)
+    return unary_op(e->m_token, v);
+}
+
+Value Interpreter::unary_op(const Token &op, Value v)
+{
+    switch (op.m_type)
     {
     case TokenType::Not:
-    {
-        Object *r = GC::instance().new_object(ObjectType::Bool);
-        GC::instance().get_interp()->get_tmp_vals().push_back(r);
-        static_cast<Bool *>(r)->m_val = !is_true(o);
-        return r;
-    }
+        return Value::boolean(!is_true(v));
     case TokenType::Minus:
-        if (Int *i = dynamic_cast<Int *>(o))
+        if (v.m_tag == ObjectType::Int)
         {
-            Object *r = GC::instance().new_object(ObjectType::Int);
-            GC::instance().get_interp()->get_tmp_vals().push_back(r);
-            static_cast<Int *>(r)->m_val = -i->m_val;
-            return r;
+            return Value::integer(-v.m_int);
         }
-        if (Float *f = dynamic_cast<Float *>(o))
+        if (v.m_tag == ObjectType::Float)
         {
-            Object *r = GC::instance().new_object(ObjectType::Float);
-            GC::instance().get_interp()->get_tmp_vals().push_back(r);
-            static_cast<Float *>(r)->m_val = -f->m_val;
-            return r;
+            return Value::floating(-v.m_float);
         }
-        throw runtime_error(report_error("incorrect operand type for '" + e->m_token.m_lexeme + "' operator"));
+        throw runtime_error(report_error("incorrect operand type for '" + op.m_lexeme + "' operator"));
 
     default:
-        throw runtime_error(report_error("incorrect operand type for '" + e->m_token.m_lexeme + "' operator"));
+        throw runtime_error(report_error("incorrect operand type for '" + op.m_lexeme + "' operator"));
     }
 }
 
-Object *Interpreter::visit_call_expr(Call *e)
+Value Interpreter::visit_call_expr(Call *e)
 {
     if (auto p = dynamic_cast<Dot *>(e->m_expr))
     {
-        Object *o = evaluate(p->m_expr);
-        if (!o)
-        {
-            throw runtime_error(report_error("attempt to perform a call on null"));
-        }
-        m_tmp_vals.push_back(o);
+        Value v = evaluate(p->m_expr);
+        check_null(v, "attempt to perform a call on null");
 
-        vector<Object *> args;
+        vector<Value> args;
 
         for (auto arg : e->m_args)
         {
-            Object *tmp = evaluate(arg);
-            m_tmp_vals.push_back(tmp);
-            args.push_back(tmp);
+            args.push_back(evaluate(arg));
         }
 
-        o->m_type->check_method(p->m_name.m_lexeme, args);
+        Object *o = method_owner(v, p->m_name.m_lexeme);
+        o->m_type->resolve_method(p->m_name.symbol(), args, e->m_method_cache);
 
-        DebugManager debug_manager(this);
-        m_debug_info.back().m_line = e->m_line;
-        m_debug_info.back().m_name = "call expression";
-        m_debug_info.back().m_call_info = "method " + o->m_type->get_name() + "." + p->m_name.m_lexeme;
+        ContextManager cm(this, e->m_line, NodeKind::CallExpr, o, p->m_name.symbol());
 
-        Object *res = o->call_method(p->m_name.m_lexeme, args);
-        m_tmp_vals.push_back(res);
-        return res;
+        return o->m_type->call_cached(o, e->m_method_cache, args);
     }
 
-    Object *o = evaluate(e->m_expr);
-    if (!o)
-    {
-        throw runtime_error(report_error("attempt to perform a call on null"));
-    }
-    m_tmp_vals.push_back(o);
+    Value v = evaluate(e->m_expr);
+    check_null(v, "attempt to perform a call on null");
 
-    Callable *c = dynamic_cast<Callable *>(o);
+    Callable *c = as_callable(v);
 
     if (!c)
     {
-        throw runtime_error(report_error("'" + o->to_str() + "' is not a function or lambda"));
+        throw runtime_error(report_error("'" + v.to_str() + "' is not a function or lambda"));
     }
 
     if (c->arity() != int(e->m_args.size()))
@@ -1038,67 +1501,67 @@ Object *Interpreter::visit_call_expr(Call *e)
         throw runtime_error(report_error("incorrect number of arguments for '" + c->to_str() + "'"));
     }
 
-    vector<Object *> args;
+    vector<Value> args;
 
     for (auto arg : e->m_args)
     {
-        Object *tmp = evaluate(arg);
-        m_tmp_vals.push_back(tmp);
-        args.push_back(tmp);
+        args.push_back(evaluate(arg));
     }
 
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "call expression";
-    m_debug_info.back().m_call_info = c->debug_info();
+    ContextManager cm(this, e->m_line, NodeKind::CallExpr, c);
 
-    Object *res = c->call(args);
-    m_tmp_vals.push_back(res);
-    return res;
+    return c->call(args);
 }
 
-Object *Interpreter::visit_dot_expr(Dot *e)
+Object *Interpreter::field_owner(const Value &v, const std::string &name)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "dot expression";
+    check_null(v, "attempt to access a field of null");
+
+    if (!v.is_object())
+    {
+        throw runtime_error(report_error("field '" + name + "' is not defined"));
+    }
 
-    Object *o = evaluate(e->m_expr);
-    return o->get_field(e->m_name.m_lexeme);
+    return v.m_obj;
 }
 
-Object *Interpreter::visit_subscript_expr(Subscript *e)
+Object *Interpreter::method_owner(const Value &v, const std::string &name)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "subscript expression";
-
-    Object *expr = evaluate(e->m_expr);
-    m_tmp_vals.push_back(expr);
-
-    if (auto s = dynamic_cast<String *>(expr))
+    if (!v.is_object() || !v.m_obj->m_type)
     {
-        Object *o = evaluate(e->m_index);
-        m_tmp_vals.push_back(o);
-        return s->get(o);
+        throw runtime_error(report_error("'" + v.to_str() + "' has no method '" + name + "'"));
     }
-    if (auto l = dynamic_cast<List *>(expr))
+
+    return v.m_obj;
+}
+
+Value Interpreter::visit_dot_expr(Dot *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::DotExpr);
+
+    Value v = evaluate(e->m_expr);
+    return field_owner(v, e->m_name.m_lexeme)->get_field(e->m_name.symbol(), e->m_cache);
+}
+
+Value Interpreter::visit_subscript_expr(Subscript *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::SubscriptExpr);
+
+    Value expr = evaluate(e->m_expr);
+
+    if (auto indexable = as_indexable(expr))
     {
-        Object *o = evaluate(e->m_index);
-        m_tmp_vals.push_back(o);
-        return l->get(o);
+        return indexable->get(evaluate(e->m_index));
     }
 
     return nullptr;
 }
 
-Object *Interpreter::visit_literal(Literal *e)
+Value Interpreter::visit_literal(Literal *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "literal";
+    ContextManager cm(this, e->m_line, NodeKind::Literal);
 
-    if (e->m_val)
+    if (!e->m_val.is_null())
     {
         return e->m_val;
     }
@@ -1108,53 +1571,36 @@ Object *Interpreter::visit_literal(Literal *e)
     case TokenType::Null:
         return e->m_val;
     case TokenType::IntLiteral:
-    {
-        Object *o = GC::instance().new_object(ObjectType::Int);
-        o->m_eternal = true;
-
         try
         {
-            static_cast<Int *>(o)->m_val = stoll(e->m_token.m_lexeme);
+            e->m_val = Value::integer(stoll(e->m_token.m_lexeme));
         }
         catch (const std::exception &)
         {
             throw runtime_error(report_error("invalid integer literal"));
         }
 
-        e->m_val = o;
-        return o;
-    }
+        return e->m_val;
     case TokenType::FloatLiteral:
-    {
-        Object *o = GC::instance().new_object(ObjectType::Float);
-        o->m_eternal = true;
-
         try
         {
-            static_cast<Float *>(o)->m_val = stod(e->m_token.m_lexeme);
+            e->m_val = Value::floating(stod(e->m_token.m_lexeme));
         }
         catch (const std::exception &)
         {
             throw runtime_error(report_error("invalid floating point literal"));
         }
 
-        e->m_val = o;
-        return o;
-    }
+        return e->m_val;
     case TokenType::True:
     case TokenType::False:
-    {
-        Object *o = GC::instance().new_object(ObjectType::Bool);
-        o->m_eternal = true;
-        static_cast<Bool *>(o)->m_val = e->m_token.m_type == TokenType::True;
-        e->m_val = o;
-        return o;
-    }
+        e->m_val = Value::boolean(e->m_token.m_type == TokenType::True);
+        return e->m_val;
     case TokenType::StrLiteral:
     {
         Object *o = GC::instance().new_object(ObjectType::String);
         o->m_eternal = true;
-        dynamic_cast<String *>(o)->m_val = e->m_token.m_lexeme;
+        static_cast<String *>(o)->m_val = e->m_token.m_lexeme;
         e->m_val = o;
         return o;
     }
@@ -1163,94 +1609,124 @@ Object *Interpreter::visit_literal(Literal *e)
     }
 }
 
-bool Interpreter::is_true(Object *o)
+bool Interpreter::is_true(const Value &v)
 {
-    if (!o)
+    switch (v.m_tag)
     {
+    case ObjectType::Null:
         return false;
+    case ObjectType::Bool:
+        return v.m_bool;
+    case ObjectType::String:
+        return !static_cast<String *>(v.m_obj)->view().empty();
+    case ObjectType::Int:
+        return v.m_int != 0;
+    case ObjectType::Float:
+        return v.m_float != 0.0;
+    case ObjectType::List:
+        return !static_cast<List *>(v.m_obj)->m_vals.empty();
+    case ObjectType::Dict:
+        return static_cast<Dict *>(v.m_obj)->m_table.m_count != 0;
+    case ObjectType::Set:
+        return static_cast<Set *>(v.m_obj)->m_table.m_count != 0;
+    case ObjectType::IntArray:
+        return !static_cast<IntArray *>(v.m_obj)->m_vals.empty();
+    case ObjectType::FloatArray:
+        return !static_cast<FloatArray *>(v.m_obj)->m_vals.empty();
+    case ObjectType::Range:
+        return static_cast<Range *>(v.m_obj)->size() != 0;
+    default:
+        return true;
     }
+}
 
-    if (Bool *b = dynamic_cast<Bool *>(o))
-    {
-        return b->m_val;
-    }
+Value Interpreter::visit_var(Var *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Var);
 
-    if (String *s = dynamic_cast<String *>(o))
-    {
-        return !s->m_val.empty();
-    }
+    return m_env.get(e->m_token, e->m_loc);
+}
 
-    if (Int *i = dynamic_cast<Int *>(o))
-    {
-        return i->m_val != 0;
-    }
+Value Interpreter::visit_lambda(Lambda *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::Lambda);
 
-    if (Float *f = dynamic_cast<Float *>(o))
+    Object *lf = make_lambda(e, nullptr);
+    m_tmp_vals.push_back(lf);
+    return lf;
+}
+
+Object *Interpreter::make_lambda(Lambda *l, Chunk *chunk)
+{
+    LambdaFunction *lf = static_cast<LambdaFunction *>(GC::instance().new_object<LambdaFunction>());
+    lf->m_interp = this;
+    lf->m_l = l;
+    lf->m_chunk = chunk;
+    lf->m_capture.assign(l->m_capture_size, Environment::undefined());
+    for (size_t i = 0; i < l->m_capture.size(); ++i)
     {
-        return f->m_val != 0.0;
+        lf->m_capture[l->m_capture_slots[i]] = m_env.get(l->m_capture[i], l->m_capture_locs[i]);
     }
+    return lf;
+}
+
+Value Interpreter::visit_list(ListExpr *e)
+{
+    ContextManager cm(this, e->m_line, NodeKind::List);
 
-    if (List *l = dynamic_cast<List *>(o))
+    // the elements stay reachable from the temporaries until the list is created
+    vector<Value> vals;
+    for (auto el : e->m_params)
     {
-        return !l->m_vals.empty();
+        vals.push_back(evaluate(el));
     }
 
-    return true;
+    Object *o = GC::instance().new_object(ObjectType::List);
+    static_cast<List *>(o)->m_vals = move(vals);
+
+    return o;
 }
 
-Object *Interpreter::visit_var(Var *e)
+Value Interpreter::visit_dict(DictExpr *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "variable";
+    ContextManager cm(this, e->m_line, NodeKind::Dict);
 
-    return m_env.get(e->m_token);
-}
+    // the pairs stay reachable from the temporaries until the dict is filled
+    vector<Value> keys;
+    vector<Value> vals;
+    for (size_t i = 0; i < e->m_keys.size(); ++i)
+    {
+        keys.push_back(evaluate(e->m_keys[i]));
+        vals.push_back(evaluate(e->m_vals[i]));
+    }
 
-Object *Interpreter::visit_lambda(Lambda *e)
-{
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "lambda";
+    Dict *o = static_cast<Dict *>(GC::instance().new_object(ObjectType::Dict));
+    m_tmp_vals.push_back(o);
 
-    LambdaFunction *lf = dynamic_cast<LambdaFunction *>(GC::instance().new_object<LambdaFunction>());
-    m_tmp_vals.push_back(lf);
-    lf->m_interp = this;
-    lf->m_l = e;
-    for (auto t : e->m_capture)
+    for (size_t i = 0; i < keys.size(); ++i)
     {
-        lf->m_capture.emplace(t.m_lexeme, m_env.get(t));
+        o->set(keys[i], vals[i]);
     }
-    return lf;
+
+    return o;
 }
 
-Object *Interpreter::visit_list(ListExpr *e)
+Value Interpreter::visit_set(SetExpr *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "list";
+    ContextManager cm(this, e->m_line, NodeKind::Set);
 
-    vector<Object *> vals;
+    vector<Value> vals;
     for (auto el : e->m_params)
     {
-        Object *v = evaluate(el);
-        if (v)
-        {
-            v->m_eternal = true;
-        }
-        vals.push_back(v);
+        vals.push_back(evaluate(el));
     }
 
-    Object *o = GC::instance().new_object(ObjectType::List);
+    Set *o = static_cast<Set *>(GC::instance().new_object(ObjectType::Set));
     m_tmp_vals.push_back(o);
-    dynamic_cast<List *>(o)->m_vals = vals;
 
-    for (auto el : dynamic_cast<List *>(o)->m_vals)
+    for (auto &val : vals)
     {
-        if (el)
-        {
-            el->m_eternal = false;
-        }
+        o->add(val);
     }
 
     return o;
@@ -1258,41 +1734,38 @@ Object *Interpreter::visit_list(ListExpr *e)
 
 void Interpreter::visit_var_stmt(VarStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "var statement";
+    ContextManager cm(this, e->m_line, NodeKind::VarStmt);
 
-    m_env.define(e->m_token, e->m_expr ? evaluate_whole_expr(e->m_expr) : nullptr);
+    m_env.define(e->m_token, e->m_expr ? evaluate_whole_expr(e->m_expr) : Value(), e->m_loc);
 }
 
 void Interpreter::visit_assignment_stmt(AssignmentStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "assignment statement";
+    ContextManager cm(this, e->m_line, NodeKind::AssignmentStmt);
 
     if (auto p = dynamic_cast<Var *>(e->m_lval))
     {
-        m_env.assign(p->m_token, evaluate_whole_expr(e->m_expr));
+        m_env.assign(p->m_token, evaluate_whole_expr(e->m_expr), p->m_loc);
         return;
     }
+    // the operands stay reachable from the temporaries until the assignment is done
+    StackTmpManager stm(m_tmp_vals.size());
+
     if (auto p2 = dynamic_cast<Dot *>(e->m_lval))
     {
-        Object *o = evaluate_whole_expr(p2->m_expr);
-        o->m_eternal = true;
-        o->set_field(p2->m_name.m_lexeme, evaluate_whole_expr(e->m_expr));
-        o->m_eternal = false;
+        Value o = evaluate(p2->m_expr);
+        Value val = evaluate(e->m_expr);
+        field_owner(o, p2->m_name.m_lexeme)->set_field(p2->m_name.symbol(), val, e->m_cache);
         return;
     }
     if (auto p3 = dynamic_cast<Subscript *>(e->m_lval))
     {
-        Object *o = evaluate_whole_expr(p3->m_expr);
-        o->m_eternal = true;
-        if (auto a = dynamic_cast<Indexable *>(o))
+        Value o = evaluate(p3->m_expr);
+        if (auto indexable = as_indexable(o))
         {
-            a->set(evaluate_whole_expr(p3->m_index), evaluate_whole_expr(e->m_expr));
+            Value index = evaluate(p3->m_index);
+            indexable->set(index, evaluate(e->m_expr));
         }
-        o->m_eternal = false;
         return;
     }
 
@@ -1301,26 +1774,20 @@ void Interpreter::visit_assignment_stmt(AssignmentStmt *e)
 
 void Interpreter::visit_expression_stmt(ExpressionStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "expression statement";
+    ContextManager cm(this, e->m_line, NodeKind::ExpressionStmt);
 
     evaluate_whole_expr(e->m_expr);
 }
 
 void Interpreter::visit_if_stmt(IfStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "if statement";
+    ContextManager cm(this, e->m_line, NodeKind::IfStmt);
 
     for (size_t i = 0; i < e->m_conds.size(); ++i)
     {
-        Object *o = evaluate_whole_expr(e->m_conds[i]);
-
-        if (is_true(o))
+        if (is_true(evaluate_whole_expr(e->m_conds[i])))
         {
-            Scope s(m_env, Environment::ScopeType::If);
+            Scope s(m_env, Environment::ScopeType::If, e->m_then_sizes[i]);
             execute(e->m_then_branches[i]);
             return;
         }
@@ -1328,267 +1795,335 @@ void Interpreter::visit_if_stmt(IfStmt *e)
 
     if (!e->m_else_branch.empty())
     {
-        Scope s(m_env, Environment::ScopeType::If);
+        Scope s(m_env, Environment::ScopeType::If, e->m_else_size);
         execute(e->m_else_branch);
     }
 }
 
 void Interpreter::visit_while_stmt(WhileStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "while statement";
+    ContextManager cm(this, e->m_line, NodeKind::WhileStmt);
 
-    try
+    while (is_true(evaluate_whole_expr(e->m_cond)))
     {
-        while (is_true(evaluate_whole_expr(e->m_cond)))
         {
-            try
-            {
-                Scope s(m_env, Environment::ScopeType::While);
-                execute(e->m_do_branch);
-            }
-            catch (ContinueSignal)
-            {
-                // empty
-            }
+            Scope s(m_env, Environment::ScopeType::While, e->m_do_size);
+            execute(e->m_do_branch);
+        }
+
+        if (!end_iteration())
+        {
+            break;
         }
-    }
-    catch (BreakSignal)
-    {
-        // empty
     }
 }
 
 void Interpreter::visit_for_stmt(ForStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "for statement";
+    ContextManager cm(this, e->m_line, NodeKind::ForStmt);
 
-    try
+    if (e->m_begin)
     {
-        Scope hs(m_env, Environment::ScopeType::ForHeader);
+        Value begin = evaluate_whole_expr(e->m_begin);
+        check_null(begin, "first index in range cannot be null");
+        Value end = evaluate_whole_expr(e->m_end);
+        check_null(end, "last index in range cannot be null");
+        Value step = Value::integer(1);
 
-        if (e->m_begin)
+        if (e->m_step)
         {
-            Object *begin_obj = evaluate_whole_expr(e->m_begin);
-            check_null(begin_obj, "first index in range cannot be null");
-            begin_obj->m_eternal = true;
-            Object *end_obj = evaluate_whole_expr(e->m_end);
-            check_null(end_obj, "last index in range cannot be null");
-            end_obj->m_eternal = true;
-            Object *step_obj = nullptr;
+            step = evaluate_whole_expr(e->m_step);
+            check_null(step, "step in range cannot be null");
+        }
 
-            if (e->m_step)
-            {
-                step_obj = evaluate_whole_expr(e->m_step);
-                check_null(step_obj, "step in range cannot be null");
-            }
-            else
-            {
-                step_obj = GC::instance().new_object(ObjectType::Int);
-                dynamic_cast<Int *>(step_obj)->m_val = 1;
-            }
+        if (begin.m_tag != ObjectType::Int)
+        {
+            throw runtime_error(report_error("first index in range must be an integer"));
+        }
+        if (end.m_tag != ObjectType::Int)
+        {
+            throw runtime_error(report_error("last index in range must be an integer"));
+        }
+        if (step.m_tag != ObjectType::Int)
+        {
+            throw runtime_error(report_error("step in range must be an integer"));
+        }
 
-            begin_obj->m_eternal = false;
-            end_obj->m_eternal = false;
+        if (step.m_int == 0)
+        {
+            throw runtime_error(report_error("step in range must not be 0"));
+        }
 
-            Int *ibegin = dynamic_cast<Int *>(begin_obj);
-            if (!ibegin)
-            {
-                throw runtime_error(report_error("first index in range must be an integer"));
-            }
-            Int *iend = dynamic_cast<Int *>(end_obj);
-            if (!iend)
-            {
-                throw runtime_error(report_error("last index in range must be an integer"));
-            }
-            Int *istep = dynamic_cast<Int *>(step_obj);
-            if (!istep)
+        // the loop variable is an unboxed integer stored into the same slot on every iteration
+        // when the body declares no variables, else into the slot of a fresh body scope
+        Scope hs(m_env, Environment::ScopeType::ForHeader, e->m_header_size);
+        unsigned long long i = begin.m_int;
+
+        for (auto n = Range::length(begin.m_int, end.m_int, step.m_int); n > 0; --n, i += step.m_int)
+        {
             {
-                throw runtime_error(report_error("step in range must be an integer"));
+                Scope s(m_env, Environment::ScopeType::For, e->m_do_size);
+                m_env.store(e->m_loc, Value::integer(i));
+                execute(e->m_do_branch);
             }
 
-            if (istep->m_val == 0)
+            if (!end_iteration())
             {
-                throw runtime_error(report_error("step in range must not be 0"));
+                break;
             }
+        }
+    }
+    else if (e->m_iterable)
+    {
+        Value iterable = evaluate_whole_expr(e->m_iterable);
+        Value it = iter_init(iterable);
+
+        Scope hs(m_env, Environment::ScopeType::ForHeader, e->m_header_size);
+        hs.m_env.define(Token(TokenType::Var, "__for_iterable__", 0, 0), iterable, Location{0, 0});
+        hs.m_env.define(Token(TokenType::Var, "__for_it__", 0, 0), it, Location{0, 1});
 
-            hs.m_env.define(Token(TokenType::Var, "__for_begin__", 0, 0), ibegin);
-            hs.m_env.define(Token(TokenType::Var, "__for_end__", 0, 0), iend);
-            hs.m_env.define(Token(TokenType::Var, "__for_step__", 0, 0), istep);
+        try
+        {
+            iter_check(it);
 
-            for (long long i = ibegin->m_val; istep->m_val > 0 ? i < iend->m_val : i > iend->m_val; i += istep->m_val)
+            while (iter_has_next(it))
             {
-                try
+                Value el = iter_next(it);
+
                 {
-                    Scope s(m_env, Environment::ScopeType::For);
-                    Object *curr = GC::instance().new_object(ObjectType::Int);
-                    dynamic_cast<Int *>(curr)->m_val = i;
-                    s.m_env.define(e->m_identifier, curr);
+                    Scope s(m_env, Environment::ScopeType::For, e->m_do_size);
+                    s.m_env.store(e->m_loc, el);
                     execute(e->m_do_branch);
                 }
-                catch (ContinueSignal)
+
+                if (!end_iteration())
                 {
-                    // empty
+                    break;
                 }
             }
         }
-        else if (e->m_iterable)
+        catch (const std::exception &)
         {
-            Object *iterable = evaluate_whole_expr(e->m_iterable);
-            check_null(iterable, "attempt to iterate through null");
-            iterable->m_eternal = true;
-            Object *it = nullptr;
+            throw runtime_error(report_error("invalid iterator"));
+        }
+    }
+}
 
-            auto *cls = dynamic_cast<Class *>(iterable->m_type);
-            auto *str = dynamic_cast<String *>(iterable->m_type);
-            auto *lst = dynamic_cast<List *>(iterable->m_type);
+Value Interpreter::iter_init(Value iterable)
+{
+    check_null(iterable, "attempt to iterate through null");
 
-            if (!str && !lst && !cls)
-            {
-                throw runtime_error(report_error("uniterable object"));
-            }
+    StackTmpManager stm(m_tmp_vals.size());
+    m_tmp_vals.push_back(iterable);
+
+    // the builtin types make their iterators directly, only a class is asked for one by the name _iter_
+    switch (iterable.m_tag)
+    {
+    case ObjectType::String:
+        return String::iter(iterable.m_obj, no_args);
+    case ObjectType::List:
+        return List::iter(iterable.m_obj, no_args);
+    case ObjectType::Dict:
+        return Dict::iter(iterable.m_obj, no_args);
+    case ObjectType::Set:
+        return Set::iter(iterable.m_obj, no_args);
+    case ObjectType::IntArray:
+        return IntArray::iter(iterable.m_obj, no_args);
+    case ObjectType::FloatArray:
+        return FloatArray::iter(iterable.m_obj, no_args);
+    case ObjectType::Range:
+        return Range::iter(iterable.m_obj, no_args);
+    default:
+        break;
+    }
 
-            try
-            {
-                iterable->m_type->check_method("_iter_", vector<Object *>());
-            }
-            catch (const std::exception &)
-            {
-                iterable->m_eternal = false;
-                throw runtime_error(report_error("uniterable object"));
-            }
+    if (!(iterable.is_object() && dynamic_cast<Class *>(iterable.m_obj->m_type)))
+    {
+        throw runtime_error(report_error("uniterable object"));
+    }
 
-            it = iterable->call_method("_iter_", vector<Object *>());
-            check_null(it, "iterator cannot be null");
+    try
+    {
+        iterable.m_obj->m_type->check_method(iter_symbol, no_args);
+    }
+    catch (const std::exception &)
+    {
+        throw runtime_error(report_error("uniterable object"));
+    }
 
-            iterable->m_eternal = false;
+    Value it = iterable.m_obj->call_method(iter_symbol, no_args);
+    check_null(it, "iterator cannot be null");
 
-            hs.m_env.define(Token(TokenType::Var, "__for_iterable__", 0, 0), iterable);
-            hs.m_env.define(Token(TokenType::Var, "__for_it__", 0, 0), it);
+    return it;
+}
 
-            try
-            {
-                it->m_type->check_method("_has_next_", vector<Object *>());
-                it->m_type->check_method("_next_", vector<Object *>());
+void Interpreter::iter_check(const Value &it)
+{
+    if (!it.is_object() || !it.m_obj->m_type)
+    {
+        throw runtime_error("");
+    }
 
-                Bool *has_next = dynamic_cast<Bool *>(it->call_method("_has_next_", vector<Object *>()));
+    if (native_has_next(it.m_tag))
+    {
+        return;
+    }
 
-                if (!has_next)
-                {
-                    throw runtime_error("");
-                }
+    it.m_obj->m_type->check_method(has_next_symbol, no_args);
+    it.m_obj->m_type->check_method(next_symbol, no_args);
+}
 
-                while (has_next->m_val)
-                {
-                    Object *el = it->call_method("_next_", vector<Object *>());
-
-                    try
-                    {
-                        Scope s(m_env, Environment::ScopeType::For);
-                        s.m_env.define(e->m_identifier, el);
-                        execute(e->m_do_branch);
-                    }
-                    catch (ContinueSignal)
-                    {
-                        // empty
-                    }
-
-                    has_next = dynamic_cast<Bool *>(it->call_method("_has_next_", vector<Object *>()));
-                }
-            }
-            catch (const std::exception &)
-            {
-                throw runtime_error(report_error("invalid iterator"));
-            }
-        }
-    }
-    catch (BreakSignal)
+bool Interpreter::iter_has_next(const Value &it)
+{
+    NativeMethod has_next_fn = native_has_next(it.m_tag);
+    Value has_next = has_next_fn ? has_next_fn(it.m_obj, no_args) : it.m_obj->call_method(has_next_symbol, no_args);
+
+    if (has_next.m_tag != ObjectType::Bool)
     {
-        // empty
+        throw runtime_error("");
     }
+
+    return has_next.m_bool;
+}
+
+Value Interpreter::iter_next(const Value &it)
+{
+    NativeMethod next_fn = native_next(it.m_tag);
+    return next_fn ? next_fn(it.m_obj, no_args) : it.m_obj->call_method(next_symbol, no_args);
 }
 
 void Interpreter::visit_break_stmt([[maybe_unused]] BreakStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "break statement";
+    ContextManager cm(this, e->m_line, NodeKind::BreakStmt);
 
-    throw BreakSignal();
+    m_completion = Completion::Break;
 }
 
 void Interpreter::visit_continue_stmt([[maybe_unused]] ContinueStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "continue statement";
+    ContextManager cm(this, e->m_line, NodeKind::ContinueStmt);
 
-    throw ContinueSignal();
+    m_completion = Completion::Continue;
 }
 
 void Interpreter::visit_fun_stmt(FunStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "fun statement";
+    ContextManager cm(this, e->m_line, NodeKind::FunStmt);
+
+    define_function(e, nullptr);
+}
 
-    Function *fn = dynamic_cast<Function *>(GC::instance().new_object<Function>());
+void Interpreter::define_function(FunStmt *fst, Chunk *chunk)
+{
+    Function *fn = static_cast<Function *>(GC::instance().new_object<Function>());
     fn->m_interp = this;
-    fn->m_fst = e;
+    fn->m_fst = fst;
+    fn->m_chunk = chunk;
     m_env.define(Token(TokenType::Var, fn->m_fst->m_name.m_lexeme, 0, 0), fn);
 }
 
 void Interpreter::visit_return_stmt(ReturnStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "return statement";
+    ContextManager cm(this, e->m_line, NodeKind::ReturnStmt);
 
-    Object *r = e->m_expr == nullptr ? nullptr : evaluate_whole_expr(e->m_expr);
-    throw ReturnSignal(r);
+    m_return_value = e->m_expr == nullptr ? Value() : evaluate_whole_expr(e->m_expr);
+    m_completion = Completion::Return;
 }
 
 void Interpreter::visit_class_stmt(ClassStmt *e)
 {
-    DebugManager debug_manager(this);
-    m_debug_info.back().m_line = e->m_line;
-    m_debug_info.back().m_name = "class statement";
+    ContextManager cm(this, e->m_line, NodeKind::ClassStmt);
+
+    define_class(e, vector<Chunk *>(e->m_methods.size(), nullptr));
+}
 
-    Class *cl = dynamic_cast<Class *>(GC::instance().new_object<Class>());
+void Interpreter::define_class(ClassStmt *cst, const std::vector<Chunk *> &chunks)
+{
+    Class *cl = static_cast<Class *>(GC::instance().new_object<Class>());
     cl->m_interp = this;
-    cl->m_cst = e;
+    cl->m_cst = cst;
+    cl->m_method_key = cst;
 
     m_env.define(Token(TokenType::Var, cl->m_cst->m_name.m_lexeme, 0, 0), cl);
 
-    for (const auto &f : e->m_methods)
+    for (size_t i = 0; i < cst->m_methods.size(); ++i)
     {
-        Function *fn = dynamic_cast<Function *>(GC::instance().new_object<Function>());
+        Function *fn = static_cast<Function *>(GC::instance().new_object<Function>());
         fn->m_interp = this;
-        fn->m_fst = f.get();
-        fn->m_class_name = e->m_name.m_lexeme;
-        if (cl->m_methods.find(fn->m_fst->m_name.m_lexeme) != cl->m_methods.end())
+        fn->m_fst = cst->m_methods[i].get();
+        fn->m_chunk = chunks[i];
+        fn->m_class_name = cst->m_name.m_lexeme;
+        if (cl->m_methods.find(fn->m_fst->m_name.symbol()) != cl->m_methods.end())
         {
             throw runtime_error(report_error("duplicate method '" + fn->m_fst->m_name.m_lexeme + "' in class '" + cl->m_cst->m_name.m_lexeme + "'"));
         }
-        cl->m_methods.emplace(fn->m_fst->m_name.m_lexeme, fn);
+        cl->m_methods.emplace(fn->m_fst->m_name.symbol(), fn);
+        cl->m_method_list.push_back(fn);
+        GC::instance().write_barrier(cl, fn);
     }
 }
 
 size_t Interpreter::get_curr_error_line()
 {
-    return m_debug_info.empty() ? 0 : m_debug_info.back().m_line;
+    return m_context ? m_context->m_line : 0;
 }
 
 std::string Interpreter::get_curr_error_element()
 {
-    return m_debug_info.empty() ? "" : m_debug_info.back().m_name;
+    return m_context ? node_kind_name(m_context->m_kind) : "";
+}
+
+std::string Interpreter::call_name(const Context *c)
+{
+    if (c->m_method)
+    {
+        return "method " + c->m_callee->m_type->get_name() + "." + *c->m_method;
+    }
+
+    return static_cast<Callable *>(c->m_callee)->debug_info();
+}
+
+void Interpreter::take_sample(bool entering)
+{
+    Profiler::clear_pending();
+
+    if (!m_profiler)
+    {
+        return;
+    }
+
+    if (m_vm)
+    {
+        m_vm->sync_debug_info();
+    }
+
+    // each call runs at the line of the innermost context below it, the script at the line of the outermost call
+    vector<Profiler::Frame> stack;
+    size_t line = get_curr_error_line();
+
+    for (Context *c = m_context; c; c = c->m_parent)
+    {
+        if (c->m_kind == NodeKind::CallExpr && !(entering && c == m_context))
+        {
+            // line 0: the callee is still binding its arguments
+            stack.push_back({call_name(c), line ? line : c->m_line});
+            line = c->m_line;
+        }
+    }
+
+    stack.push_back({"script", line});
+    reverse(stack.begin(), stack.end());
+
+    m_profiler->add_sample(move(stack));
 }
 
 std::string Interpreter::report_error(std::string desc)
 {
+    if (m_vm)
+    {
+        m_vm->sync_debug_info();
+    }
+
     ostringstream res;
 
     res << "Execution error\n";
@@ -1596,12 +2131,14 @@ std::string Interpreter::report_error(std::string desc)
 
     res << "Call stack\n";
 
-    for (auto i = m_debug_info.rbegin(); i != m_debug_info.rend(); ++i)
+    for (Context *c = m_context; c; c = c->m_parent)
     {
-        if (i->m_name == "call expression")
+        if (c->m_kind != NodeKind::CallExpr)
         {
-            res << "    " << i->m_call_info << " (at line " << i->m_line << ")\n";
+            continue;
         }
+
+        res << "    " << call_name(c) << " (at line " << c->m_line << ")\n";
     }
 
     res << "    script: " << m_script;
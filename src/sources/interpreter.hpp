@@ -1,11 +1,13 @@
 #pragma once
 
+#include "chunk.hpp"
 #include "expr.hpp"
 #include "object.hpp"
 #include "gc.hpp"
 #include "env.hpp"
 #include "stmt.hpp"
-#include "gc.hpp"
+#include "profiler.hpp"
+#include "counters.hpp"
 
 #include <functional>
 #include <memory>
@@ -15,109 +17,113 @@
 
 namespace halo
 {
+    class VM;
 
     class Interpreter : public ExprVisitor, public StmtVisitor
     {
         friend class GC;
+        friend class VM;
 
-        struct DebugInfo
+        // what is being executed, read only by report_error(): each context lives on the C++ stack
+        // of the visit that creates it and links to the enclosing one, so tracking costs two stores,
+        // and the error element and the call stack are only turned into strings when an error is reported
+        struct Context
         {
+            Context *m_parent;
             size_t m_line;
-            std::string m_name;
-            std::string m_call_info;
+            NodeKind m_kind;
+            // of a call expression: the callee, or the receiver if m_method is set
+            Object *m_callee;
+            Symbol m_method;
         };
 
-        struct DebugManager
+        struct ContextManager
         {
             Interpreter *m_interp;
-
-            DebugManager(Interpreter *interp)
-                : m_interp(interp)
+            Context m_context;
+
+            // the manager is always a local of the visit it tracks, and its destructor unlinks the context
+            // before the visit returns, so the address stored below never outlives it
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif
+            ContextManager(Interpreter *interp, size_t line, NodeKind kind, Object *callee = nullptr, Symbol method = nullptr)
+                : m_interp(interp), m_context{interp->m_context, line, kind, callee, method}
             {
-                m_interp->m_debug_info.emplace_back();
+                m_interp->m_context = &m_context;
+
+                if (Profiler::pending())
+                {
+                    m_interp->take_sample(true);
+                }
             }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic pop
+#endif
 
-            ~DebugManager()
+            ~ContextManager()
             {
-                m_interp->m_debug_info.pop_back();
+                // the only chance to sample a native callee while it runs
+                if (m_context.m_kind == NodeKind::CallExpr && Profiler::pending())
+                {
+                    m_interp->take_sample(false);
+                }
+
+                m_interp->m_context = m_context.m_parent;
             }
         };
 
-        std::vector<DebugInfo> m_debug_info;
+        Context *m_context = nullptr;
+
+        // how the last statement completed: break, continue and return make execute()
+        // return early up to the loop or run_body() that handles them, without unwinding
+        enum class Completion
+        {
+            Normal,
+            Break,
+            Continue,
+            Return
+        };
+
+        Completion m_completion = Completion::Normal;
+        Value m_return_value;
 
         Environment m_env;
-        std::vector<Object *> m_tmp_vals;
+        std::vector<Value> m_tmp_vals;
         std::istream &m_in;
         std::ostream &m_out;
         int m_fun_scope_counter;
         int m_max_fun_depth;
         std::string m_script;
+        VM *m_vm;
+        Profiler *m_profiler = nullptr;
+        Counters *m_counters = nullptr;
 
-        template <typename OpType, ObjectType ObType, typename ResType = OpType, typename Op>
-        Object *bin_op(Object *left, Object *right, Op op)
-        {
-            if (OpType *p_left = dynamic_cast<OpType *>(left))
-            {
-                if (OpType *p_right = dynamic_cast<OpType *>(right))
-                {
-                    Object *r = GC::instance().new_object(ObType);
-                    m_tmp_vals.push_back(r);
-                    dynamic_cast<ResType *>(r)->m_val = op(p_left->m_val, p_right->m_val);
-                    return r;
-                }
-            }
+        static bool is_true(const Value &v);
+        // resets the completion of a loop body, returns false if the loop must stop
+        bool end_iteration();
 
-            return nullptr;
-        }
+        Value binary_op(const Token &op, Value v1, Value v2);
+        Value unary_op(const Token &op, Value v);
 
-        template <typename OpType1, typename OpType2, ObjectType ObType, typename ResType = OpType1, typename Op>
-        Object *bin_op_conv(Object *left, Object *right, Op op)
-        {
-            if (OpType1 *p_left = dynamic_cast<OpType1 *>(left))
-            {
-                if (OpType2 *p_right = dynamic_cast<OpType2 *>(right))
-                {
-                    Object *r = GC::instance().new_object(ObType);
-                    m_tmp_vals.push_back(r);
-                    static_cast<ResType *>(r)->m_val = op(p_left->m_val, p_right->m_val);
-                    return r;
-                }
-            }
-            if (OpType2 *p_left = dynamic_cast<OpType2 *>(left))
-            {
-                if (OpType1 *p_right = dynamic_cast<OpType1 *>(right))
-                {
-                    Object *r = GC::instance().new_object(ObType);
-                    m_tmp_vals.push_back(r);
-                    static_cast<ResType *>(r)->m_val = op(p_left->m_val, p_right->m_val);
-                    return r;
-                }
-            }
-
-            return nullptr;
-        }
-
-        bool equals(Object *o1, Object *o2)
-        {
-            if (o1 == nullptr && o2 == nullptr)
-            {
-                return true;
-            }
-
-            if (o2 == nullptr)
-            {
-                return false;
-            }
-
-            return o1->equals(o2);
-        }
+        Object *field_owner(const Value &v, const std::string &name);
+        Object *method_owner(const Value &v, const std::string &name);
 
-        static bool is_true(Object *o);
+        Value iter_init(Value iterable);
+        void iter_check(const Value &it);
+        bool iter_has_next(const Value &it);
+        Value iter_next(const Value &it);
 
         size_t get_curr_error_line();
 
         std::string get_curr_error_element();
 
+        // the callee of a call expression context as shown in the call stack
+        static std::string call_name(const Context *c);
+        // entering: the innermost context has just been entered, so a call in it has not called yet
+        void take_sample(bool entering);
+
     public:
         Interpreter(std::istream &in = std::cin, std::ostream &out = std::cout);
 
@@ -163,6 +169,23 @@ namespace halo
             --m_fun_scope_counter;
         }
 
+        void set_profiler(Profiler *profiler)
+        {
+            m_profiler = profiler;
+        }
+
+        // must be set before the code the VM runs is compiled
+        void set_counters(Counters *counters)
+        {
+            m_counters = counters;
+            GC::instance().set_counters(counters);
+        }
+
+        Counters *get_counters()
+        {
+            return m_counters;
+        }
+
         void set_script(std::string script)
         {
             m_script = script;
@@ -173,36 +196,43 @@ namespace halo
             m_tmp_vals.erase(m_tmp_vals.begin() + index, m_tmp_vals.end());
         }
 
-        std::vector<Object *> &get_tmp_vals()
+        std::vector<Value> &get_tmp_vals()
         {
             return m_tmp_vals;
         }
 
-        void check_null(Object *obj, const std::string &msg)
+        void check_null(const Value &v, const std::string &msg)
         {
-            if (!obj)
+            if (v.is_null())
             {
                 throw std::runtime_error(report_error(msg));
             }
         }
 
+        Value run_body(const std::vector<std::unique_ptr<Stmt>> &body, Chunk *chunk);
+        void define_function(FunStmt *fst, Chunk *chunk);
+        void define_class(ClassStmt *cst, const std::vector<Chunk *> &chunks);
+        Object *make_lambda(Lambda *l, Chunk *chunk);
+
         void interpret(Expr *e);
-        Object *evaluate(Expr *e);
-        Object *evaluate_whole_expr(Expr *e);
+        Value evaluate(Expr *e);
+        Value evaluate_whole_expr(Expr *e);
         void execute(const std::vector<std::unique_ptr<Stmt>> &stmts);
         void execute_stmt(Stmt *stmt);
 
-        Object *visit_grouping(Grouping *e) override;
-        Object *visit_binary_expr(BinaryExpr *e) override;
-        Object *visit_logical_expr(LogicalExpr *e) override;
-        Object *visit_unary_expr(UnaryExpr *e) override;
-        Object *visit_call_expr(Call *e) override;
-        Object *visit_dot_expr(Dot *e) override;
-        Object *visit_subscript_expr(Subscript *e) override;
-        Object *visit_literal(Literal *e) override;
-        Object *visit_var(Var *e) override;
-        Object *visit_lambda(Lambda *e) override;
-        Object *visit_list(ListExpr *e) override;
+        Value visit_grouping(Grouping *e) override;
+        Value visit_binary_expr(BinaryExpr *e) override;
+        Value visit_logical_expr(LogicalExpr *e) override;
+        Value visit_unary_expr(UnaryExpr *e) override;
+        Value visit_call_expr(Call *e) override;
+        Value visit_dot_expr(Dot *e) override;
+        Value visit_subscript_expr(Subscript *e) override;
+        Value visit_literal(Literal *e) override;
+        Value visit_var(Var *e) override;
+        Value visit_lambda(Lambda *e) override;
+        Value visit_list(ListExpr *e) override;
+        Value visit_dict(DictExpr *e) override;
+        Value visit_set(SetExpr *e) override;
 
         void visit_var_stmt(VarStmt *e) override;
         void visit_assignment_stmt(AssignmentStmt *e) override;
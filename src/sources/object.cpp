@@ -2,22 +2,43 @@
 #include "gc.hpp"
 #include "token_type.hpp"
 #include "interpreter.hpp"
+#include "simd.hpp"
 #include <string>
+#include <climits>
+#include <cstring>
+#include <algorithm>
 
 using namespace std;
 using namespace halo;
 
+string Value::to_str() const
+{
+    switch (m_tag)
+    {
+    case ObjectType::Null:
+        return "null";
+    case ObjectType::Int:
+        return to_string(m_int);
+    case ObjectType::Float:
+        return to_string(m_float);
+    case ObjectType::Bool:
+        return m_bool ? "true" : "false";
+    default:
+        return m_obj->to_str();
+    }
+}
+
 string Object::to_str() const
 {
     std::string res = m_type->get_name() + "[";
     bool first = true;
 
-    for (auto field : m_fields)
+    for (size_t i = 0; i < m_slots.size(); ++i)
     {
         res += first ? "" : ", ";
-        res += field.first;
+        res += *m_shape->m_names[i];
         res += "=";
-        res += field.second ? field.second->to_str() : "null";
+        res += m_slots[i].to_str();
         first = false;
     }
 
@@ -26,44 +47,9 @@ string Object::to_str() const
     return res;
 }
 
-string Int::to_str() const
-{
-    return to_string(m_val);
-}
-
-void Int::mark()
-{
-    m_marked = true;
-}
-
-string Float::to_str() const
-{
-    return to_string(m_val);
-}
-
-void Float::mark()
-{
-    m_marked = true;
-}
-
-string Bool::to_str() const
-{
-    return m_val ? "true" : "false";
-}
-
-void Bool::mark()
-{
-    m_marked = true;
-}
-
 string String::to_str() const
 {
-    return m_val;
-}
-
-void String::mark()
-{
-    m_marked = true;
+    return string(view());
 }
 
 string List::to_str() const
@@ -74,7 +60,7 @@ string List::to_str() const
     for (auto val : m_vals)
     {
         res += first ? "" : ", ";
-        res += val->to_str();
+        res += val.to_str();
         first = false;
     }
 
@@ -83,86 +69,87 @@ string List::to_str() const
     return res;
 }
 
-void List::mark()
+void List::trace()
 {
-    m_marked = true;
-
-    for (auto val : m_vals)
+    for (auto &val : m_vals)
     {
-        if (val && !val->m_marked)
-        {
-            val->mark();
-        }
+        val.mark();
     }
 }
 
-string Null::to_str() const
-{
-    return "null";
-}
+/* Object */
 
-void Null::mark()
+void Object::field_error(Symbol name)
 {
-    m_marked = true;
+    throw std::runtime_error(GC::instance().get_interp()->report_error("field '" + *name + "' is not defined"));
 }
 
-void StringIter::mark()
+void Object::set_field(Symbol name, Value val)
 {
-    m_marked = true;
+    size_t slot = m_shape ? m_shape->find(name) : Shape::npos;
+
+    if (slot == Shape::npos)
+    {
+        field_error(name);
+    }
+
+    m_slots[slot] = val;
+    GC::instance().write_barrier(this, val);
 }
 
-void ListIter::mark()
+Value Object::get_field(Symbol name)
 {
-    m_marked = true;
-}
+    size_t slot = m_shape ? m_shape->find(name) : Shape::npos;
 
-/* Object */
+    if (slot == Shape::npos)
+    {
+        field_error(name);
+    }
+
+    return m_slots[slot];
+}
 
-void Object::set_field(const std::string &name, Object *val)
+void Object::set_field(Symbol name, Value val, FieldCache &cache)
 {
-    auto it = m_fields.find(name);
+    size_t slot = cache.find(m_shape, name);
 
-    if (it == m_fields.end())
+    if (slot == Shape::npos)
     {
-        throw std::runtime_error(GC::instance().get_interp()->report_error("field '" + name + "' is not defined"));
+        field_error(name);
     }
 
-    it->second = val;
+    m_slots[slot] = val;
+    GC::instance().write_barrier(this, val);
 }
 
-Object *Object::get_field(const std::string &name)
+Value Object::get_field(Symbol name, FieldCache &cache)
 {
-    auto it = m_fields.find(name);
+    size_t slot = cache.find(m_shape, name);
 
-    if (it == m_fields.end())
+    if (slot == Shape::npos)
     {
-        throw std::runtime_error(GC::instance().get_interp()->report_error("field '" + name + "' is not defined"));
+        field_error(name);
     }
 
-    return it->second;
+    return m_slots[slot];
 }
 
-Object *Object::call_method(const std::string &name, const std::vector<Object *> &args)
+Value Object::call_method(Symbol name, const std::vector<Value> &args)
 {
     return m_type->call_method(this, name, args);
 }
 
-void Object::mark()
+void Object::trace()
 {
-    m_marked = true;
-
-    for (auto &[str, obj] : m_fields)
+    for (auto &val : m_slots)
     {
-        if (obj && !obj->m_marked)
-        {
-            obj->mark();
-        }
+        val.mark();
     }
 }
 
 /* Callable */
 
-Object *Callable::call([[maybe_unused]] const std::vector<Object *> &args)
+Value Callable::call([[maybe_unused]] const std::vector<Value> &args)
 {
     throw std::runtime_error(GC::instance().get_interp()->report_error("call is not implemented"));
 }
@@ -177,367 +164,1432 @@ string Callable::debug_info() const
     throw std::runtime_error(GC::instance().get_interp()->report_error("debug info is not implemented"));
 }
 
+/* NativeType */
+
+size_t NativeType::find_method(Symbol name) const
+{
+    for (size_t i = 0; i < m_method_count; ++i)
+    {
+        if (name == m_methods[i].m_name)
+        {
+            return i;
+        }
+    }
+
+    return no_method;
+}
+
+void NativeType::check_method(Symbol name, const std::vector<Value> &args)
+{
+    size_t i = find_method(name);
+
+    if (i == no_method)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("name '" + *name + "' is not defined in class " + get_name()));
+    }
+
+    if (m_methods[i].m_arity != args.size())
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid number of arguments in method '" + *name + "' in class " + get_name()));
+    }
+}
+
+Value NativeType::call_method(Object *my, Symbol name, const std::vector<Value> &args)
+{
+    size_t i = find_method(name);
+
+    if (i == no_method)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("undefined method '" + *name + "' in class " + get_name()));
+    }
+
+    return m_methods[i].m_fn(my, args);
+}
+
 /* String */
 
-Object *String::get(Object *index)
+const NativeType::Method String::methods[] = {{intern("substr"), 2, substr}, {intern("_iter_"), 0, iter}};
+
+Value String::get(Value index)
 {
-    if (auto i = dynamic_cast<Int *>(index))
+    if (tag_of(index) == ObjectType::Int)
     {
-        if (i->m_val < 0 || i->m_val > int(m_val.size() - 1))
+        long long i = index.m_int;
+
+        if (i < 0 || i > int(view().size() - 1))
         {
             throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
         }
 
-        Object *o = GC::instance().new_object(ObjectType::String);
-        dynamic_cast<String *>(o)->m_val = m_val[i->m_val];
-        return o;
+        return of_char(view()[i]);
     }
 
     throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
 }
 
-void String::set(Object *, Object *)
+void String::set(Value, Value)
 {
     throw std::runtime_error(GC::instance().get_interp()->report_error("set operation is not available for type " + get_name()));
 }
 
-Object *String::iter(Object *my)
+Value String::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto str = dynamic_cast<String *>(my);
+    auto str = static_cast<String *>(my);
 
     Object *res = GC::instance().new_object(ObjectType::StringIter);
-    dynamic_cast<StringIter *>(res)->m_beg = str->m_val.begin();
-    dynamic_cast<StringIter *>(res)->m_end = str->m_val.end();
+    static_cast<StringIter *>(res)->m_str = str;
     return res;
 }
 
-void String::check_method(const std::string &name, const std::vector<Object *> &args)
+Value String::substr(Object *my, const std::vector<Value> &args)
 {
-    static unordered_map<string, size_t> methods = {{"substr", 2}, {"_iter_", 0}};
+    auto str = static_cast<String *>(my);
+
+    if (tag_of(args[0]) != ObjectType::Int || tag_of(args[1]) != ObjectType::Int)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in method 'substr' in class " + str->get_name()));
+    }
 
-    auto it = methods.find(name);
+    long long arg1 = args[0].m_int;
+    long long arg2 = args[1].m_int;
 
-    if (it == methods.end())
+    if (arg1 < 0 || arg1 > int(str->view().size() - 1))
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("name '" + name + "' is not defined in class " + get_name()));
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid index in method 'substr' in class " + str->get_name()));
     }
 
-    if (it->second != args.size())
+    if (arg2 < 0)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid number of arguments in method '" + name + "' in class " + get_name()));
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid range in method 'substr' in class " + str->get_name()));
     }
+
+    return substring(str, arg1, min<size_t>(arg2, str->view().size() - arg1));
 }
 
-Object *String::call_method(Object *my, const std::string &name, const std::vector<Object *> &args)
+Value String::substring(String *str, size_t pos, size_t len)
 {
-    if (name == "substr")
+    if (len == 1)
     {
-        return substr(my, args);
+        return of_char(str->view()[pos]);
     }
-    else if (name == "_iter_")
+
+    String *res = static_cast<String *>(GC::instance().new_object(ObjectType::String));
+
+    if (len < min_view)
     {
-        return iter(my);
+        res->m_val = str->view().substr(pos, len);
+        return res;
     }
 
-    throw runtime_error(GC::instance().get_interp()->report_error("undefined method '" + name + "' in class " + get_name()));
+    // views always share the characters of the string that owns them, not of another view
+    res->m_base = str->m_base ? str->m_base : str;
+    res->m_offset = str->m_offset + pos;
+    res->m_len = len;
+    return res;
 }
 
-Object *String::substr(Object *my, const std::vector<Object *> &args)
+String *String::of_char(char c)
 {
-    auto arg1 = dynamic_cast<Int *>(args[0]);
-    auto arg2 = dynamic_cast<Int *>(args[1]);
+    static String *chars[256] = {};
 
-    if (!arg1 || !arg2)
+    String *&s = chars[static_cast<unsigned char>(c)];
+
+    if (!s)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in method 'substr' in class " + get_name()));
+        s = static_cast<String *>(GC::instance().new_object(ObjectType::String));
+        s->m_val = c;
+        s->m_eternal = true;
     }
 
-    auto str = dynamic_cast<String *>(my);
+    return s;
+}
+
+Value String::concat(String *left, String *right)
+{
+    String *res = static_cast<String *>(GC::instance().new_object(ObjectType::String));
+    size_t len = left->view().size() + right->view().size();
 
-    if (arg1->m_val < 0 || arg1->m_val > int(str->m_val.size() - 1))
+    if (len < min_shared)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid index in method 'substr' in class " + get_name()));
+        res->m_val.reserve(len);
+        res->m_val += left->view();
+        res->m_val += right->view();
+        return res;
     }
 
-    if (arg2->m_val < 0)
+    // the buffer of left is extended in place when left ends where the buffer does,
+    // no view of the buffer sees past its own end, so none of them changes;
+    // otherwise the result starts a new buffer
+    String *base = left->m_base;
+
+    if (base && base->m_buffer && left->m_offset + left->m_len == base->m_val.size())
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid range in method 'substr' in class " + get_name()));
+        res->m_offset = left->m_offset;
     }
+    else
+    {
+        // res is not referenced from anywhere yet
+        GC::instance().get_interp()->get_tmp_vals().push_back(res);
 
-    Object *res = GC::instance().new_object(ObjectType::String);
-    dynamic_cast<String *>(res)->m_val = str->m_val.substr(arg1->m_val, arg2->m_val);
-    return res;
-}
-
-/* StringIter */
+        base = static_cast<String *>(GC::instance().new_object(ObjectType::String));
+        base->m_buffer = true;
+        base->m_val.reserve(2 * len);
+        base->m_val += left->view();
+    }
 
-Object *StringIter::has_next(Object *my)
-{
-    auto str_iter = dynamic_cast<StringIter *>(my);
+    if (right->m_base == base)
+    {
+        // the view of right would not survive the buffer growing
+        base->m_val += string(right->view());
+    }
+    else
+    {
+        base->m_val += right->view();
+    }
 
-    Object *res = GC::instance().new_object(ObjectType::Bool);
-    dynamic_cast<Bool *>(res)->m_val = str_iter->m_beg != str_iter->m_end;
+    res->m_base = base;
+    res->m_len = len;
+    // res may have been promoted by the allocation of base
+    GC::instance().write_barrier(res, base);
     return res;
 }
 
-Object *StringIter::next(Object *my)
+void String::trace()
 {
-    auto str_iter = dynamic_cast<StringIter *>(my);
-
-    Object *res = GC::instance().new_object(ObjectType::String);
-    dynamic_cast<String *>(res)->m_val = *str_iter->m_beg;
-    ++str_iter->m_beg;
-    return res;
+    if (m_base)
+    {
+        GC::instance().shade(m_base);
+    }
 }
 
-void StringIter::check_method(const std::string &name, const std::vector<Object *> &args)
-{
-    static unordered_map<string, size_t> methods = {{"_next_", 0}, {"_has_next_", 0}};
+/* StringIter */
 
-    auto it = methods.find(name);
+const NativeType::Method StringIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
 
-    if (it == methods.end())
-    {
-        throw runtime_error(GC::instance().get_interp()->report_error("name '" + name + "' is not defined in class " + get_name()));
-    }
+Value StringIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto str_iter = static_cast<StringIter *>(my);
 
-    if (it->second != args.size())
-    {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid number of arguments in method '" + name + "' in class " + get_name()));
-    }
+    return Value::boolean(str_iter->m_pos < str_iter->m_str->view().size());
 }
 
-Object *StringIter::call_method(Object *my, const std::string &name, [[maybe_unused]] const std::vector<Object *> &args)
+Value StringIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    if (name == "_has_next_")
-    {
-        return has_next(my);
-    }
-    else if (name == "_next_")
-    {
-        return next(my);
-    }
+    auto str_iter = static_cast<StringIter *>(my);
+
+    return String::of_char(str_iter->m_str->view()[str_iter->m_pos++]);
+}
 
-    throw runtime_error(GC::instance().get_interp()->report_error("undefined method '" + name + "' in class " + get_name()));
+void StringIter::trace()
+{
+    GC::instance().shade(m_str);
 }
 
 /* List */
 
-Object *List::get(Object *index)
+const NativeType::Method List::methods[] = {{intern("put"), 1, put}, {intern("pop"), 0, pop}, {intern("pop_at"), 1, pop_at}, {intern("pop_all"), 1, pop_all}, {intern("len"), 0, len}, {intern("clear"), 0, clear}, {intern("_iter_"), 0, iter}};
+
+Value List::get(Value index)
 {
-    if (auto i = dynamic_cast<Int *>(index))
+    if (tag_of(index) == ObjectType::Int)
     {
-        if (i->m_val < 0 || i->m_val > int(m_vals.size() - 1))
+        long long i = index.m_int;
+
+        if (i < 0 || i > int(m_vals.size() - 1))
         {
             throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
         }
 
-        return m_vals[i->m_val];
+        return m_vals[i];
     }
 
     throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
 }
 
-void List::set(Object *index, Object *val)
+void List::set(Value index, Value val)
 {
-    if (auto i = dynamic_cast<Int *>(index))
+    if (tag_of(index) == ObjectType::Int)
     {
-        if (i->m_val < 0 || i->m_val > int(m_vals.size() - 1))
+        long long i = index.m_int;
+
+        if (i < 0 || i > int(m_vals.size() - 1))
         {
             throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
         }
 
-        m_vals[i->m_val] = val;
+        m_vals[i] = val;
+        GC::instance().write_barrier(this, val);
         return;
     }
 
     throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
 }
 
-Object *List::iter(Object *my)
+Value List::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
+    auto list = static_cast<List *>(my);
 
     Object *res = GC::instance().new_object(ObjectType::ListIter);
-    dynamic_cast<ListIter *>(res)->m_beg = list->m_vals.begin();
-    dynamic_cast<ListIter *>(res)->m_end = list->m_vals.end();
+    static_cast<ListIter *>(res)->m_list = list;
+    static_cast<ListIter *>(res)->m_end = list->m_vals.size();
     return res;
 }
 
-void List::check_method(const std::string &name, const std::vector<Object *> &args)
+Value List::put(Object *my, const std::vector<Value> &args)
 {
-    static unordered_map<string, size_t> methods = {{"put", 1}, {"pop", 0}, {"pop_at", 1}, {"pop_all", 1}, {"len", 0}, {"clear", 0}, {"_iter_", 0}};
+    auto list = static_cast<List *>(my);
+    list->m_vals.push_back(args[0]);
+    GC::instance().write_barrier(list, args[0]);
 
-    auto it = methods.find(name);
+    return nullptr;
+}
 
-    if (it == methods.end())
-    {
-        throw runtime_error(GC::instance().get_interp()->report_error("name '" + name + "' is not defined in class " + get_name()));
-    }
+Value List::pop(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto list = static_cast<List *>(my);
 
-    if (it->second != args.size())
+    if (list->m_vals.empty())
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid number of arguments in method '" + name + "' in class " + get_name()));
+        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'pop'"));
     }
+
+    list->m_vals.pop_back();
+
+    return nullptr;
 }
 
-Object *List::call_method(Object *my, const std::string &name, const std::vector<Object *> &args)
+Value List::pop_at(Object *my, const std::vector<Value> &args)
 {
-    if (name == "put")
-    {
-        return put(my, args);
-    }
-    if (name == "pop")
-    {
-        return pop(my);
-    }
-    if (name == "pop_at")
-    {
-        return pop_at(my, args);
-    }
-    if (name == "pop_all")
+    if (tag_of(args[0]) != ObjectType::Int)
     {
-        return pop_all(my, args);
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in 'pop_at'"));
     }
-    if (name == "len")
+
+    long long arg = args[0].m_int;
+
+    auto list = static_cast<List *>(my);
+
+    if (list->m_vals.empty())
     {
-        return len(my);
+        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'pop_at'"));
     }
-    if (name == "clear")
+
+    if (arg < 0 || arg > int(list->m_vals.size() - 1))
     {
-        return clear(my);
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid index in 'pop_at'"));
     }
-    if (name == "_iter_")
+
+    list->m_vals.erase(list->m_vals.begin() + arg);
+    GC::instance().list_erased(list, arg);
+
+    return nullptr;
+}
+
+Value List::pop_all(Object *my, const std::vector<Value> &args)
+{
+    auto list = static_cast<List *>(my);
+    auto &vals = list->m_vals;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < vals.size(); ++i)
     {
-        return iter(my);
+        if (vals[i].equals(args[0]))
+        {
+            // the element is at kept once the ones before it have been removed
+            GC::instance().list_erased(list, kept);
+        }
+        else
+        {
+            vals[kept++] = vals[i];
+        }
     }
 
-    throw runtime_error(GC::instance().get_interp()->report_error("undefined method '" + name + "' in class " + get_name()));
+    vals.resize(kept);
+
+    return nullptr;
 }
 
-Object *List::put(Object *my, const std::vector<Object *> &args)
+Value List::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
-    list->m_vals.push_back(args[0]);
+    auto list = static_cast<List *>(my);
+
+    return Value::integer(list->m_vals.size());
+}
+
+Value List::clear(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto list = static_cast<List *>(my);
+    list->m_vals.clear();
 
     return nullptr;
 }
 
-Object *List::pop(Object *my)
+/* ListIter */
+
+const NativeType::Method ListIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
+
+Value ListIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
+    auto list_iter = static_cast<ListIter *>(my);
 
-    if (list->m_vals.empty())
-    {
-        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'pop'"));
-    }
+    // the list may have lost elements while it was iterated
+    return Value::boolean(list_iter->m_pos < std::min(list_iter->m_end, list_iter->m_list->m_vals.size()));
+}
 
-    list->m_vals.pop_back();
+Value ListIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto list_iter = static_cast<ListIter *>(my);
+    auto &vals = list_iter->m_list->m_vals;
 
-    return nullptr;
+    return list_iter->m_pos < vals.size() ? vals[list_iter->m_pos++] : Value(nullptr);
 }
 
-Object *List::pop_at(Object *my, const std::vector<Object *> &args)
+void ListIter::trace()
 {
-    auto arg = dynamic_cast<Int *>(args[0]);
+    GC::instance().shade(m_list);
+}
 
-    if (!arg)
-    {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in 'pop_at'"));
-    }
+/* StringBuilder */
 
-    auto list = dynamic_cast<List *>(my);
+const NativeType::Method StringBuilder::methods[] = {{intern("append"), 1, append}, {intern("build"), 0, build}, {intern("len"), 0, len}, {intern("clear"), 0, clear}};
 
-    if (list->m_vals.empty())
+Value StringBuilder::append(Object *my, const std::vector<Value> &args)
+{
+    auto sb = static_cast<StringBuilder *>(my);
+
+    if (tag_of(args[0]) == ObjectType::String)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'pop_at'"));
+        sb->m_buf += static_cast<String *>(args[0].m_obj)->view();
     }
-
-    if (arg->m_val < 0 || arg->m_val > int(list->m_vals.size() - 1))
+    else
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid index in 'pop_at'"));
+        sb->m_buf += args[0].to_str();
     }
 
-    list->m_vals.erase(list->m_vals.begin() + arg->m_val);
-
     return nullptr;
 }
 
-Object *List::pop_all(Object *my, const std::vector<Object *> &args)
+Value StringBuilder::build(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
-    list->m_vals.erase(std::remove_if(list->m_vals.begin(), list->m_vals.end(),
-                                      [args](Object *x)
-                                      { return x->equals(args[0]); }),
-                       list->m_vals.end());
+    auto sb = static_cast<StringBuilder *>(my);
 
-    return nullptr;
+    Object *res = GC::instance().new_object(ObjectType::String);
+    static_cast<String *>(res)->m_val = sb->m_buf;
+    return res;
 }
 
-Object *List::len(Object *my)
+Value StringBuilder::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
-
-    Object *o = GC::instance().new_object(ObjectType::Int);
-    dynamic_cast<Int *>(o)->m_val = list->m_vals.size();
-    return o;
+    return Value::integer(static_cast<StringBuilder *>(my)->m_buf.size());
 }
 
-Object *List::clear(Object *my)
+Value StringBuilder::clear(Object *my, [[maybe_unused]] const std::vector<Value> &args)
 {
-    auto list = dynamic_cast<List *>(my);
-    list->m_vals.clear();
+    static_cast<StringBuilder *>(my)->m_buf.clear();
 
     return nullptr;
 }
 
-/* ListIter */
+/* HashTable */
 
-Object *ListIter::has_next(Object *my)
+namespace
 {
-    auto list_iter = dynamic_cast<ListIter *>(my);
+    uint32_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return static_cast<uint32_t>(x);
+    }
+}
 
-    Object *res = GC::instance().new_object(ObjectType::Bool);
-    dynamic_cast<Bool *>(res)->m_val = list_iter->m_beg != list_iter->m_end;
-    return res;
+bool HashTable::hash(const Value &key, uint32_t &res)
+{
+    switch (key.m_tag)
+    {
+    case ObjectType::Null:
+        res = 0;
+        return true;
+    case ObjectType::Int:
+        res = mix(key.m_int);
+        return true;
+    case ObjectType::Float:
+    {
+        // 0.0 and -0.0 are equal, so they need the same hash
+        double d = key.m_float == 0 ? 0 : key.m_float;
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        res = mix(bits);
+        return true;
+    }
+    case ObjectType::Bool:
+        res = mix(key.m_bool ? 2 : 1);
+        return true;
+    case ObjectType::String:
+        res = static_cast<uint32_t>(std::hash<string_view>()(static_cast<String *>(key.m_obj)->view()));
+        return true;
+    case ObjectType::List:
+    case ObjectType::Dict:
+    case ObjectType::Set:
+    case ObjectType::IntArray:
+    case ObjectType::FloatArray:
+        // compared by their elements, which may change
+        return false;
+    case ObjectType::Range:
+    {
+        // hashes what Range::equals compares, so equal ranges written differently agree
+        auto range = static_cast<Range *>(key.m_obj);
+        unsigned long long n = range->size();
+        res = mix(n);
+
+        if (n != 0)
+        {
+            res = mix(res ^ static_cast<uint64_t>(range->m_begin));
+        }
+
+        if (n > 1)
+        {
+            res = mix(res ^ static_cast<uint64_t>(range->m_step));
+        }
+
+        return true;
+    }
+    default:
+        // the other objects are equal only to themselves
+        res = mix(reinterpret_cast<uintptr_t>(key.m_obj));
+        return true;
+    }
 }
 
-Object *ListIter::next(Object *my)
+size_t HashTable::find_slot(const Value &key, uint32_t hash) const
 {
-    auto list_iter = dynamic_cast<ListIter *>(my);
+    if (m_slots.empty())
+    {
+        return npos;
+    }
 
-    Object *res = *list_iter->m_beg;
-    ++list_iter->m_beg;
-    return res;
+    size_t mask = m_slots.size() - 1;
+
+    // the keys are ordered by their distance from their home slot,
+    // so the search is over at a key closer to its home than key would be
+    for (size_t pos = hash & mask, dist = 0;; pos = (pos + 1) & mask, ++dist)
+    {
+        const Slot &s = m_slots[pos];
+
+        if (s.m_entry == empty || probe_distance(pos) < dist)
+        {
+            return npos;
+        }
+
+        if (s.m_hash == hash && m_entries[s.m_entry].m_key.equals(key))
+        {
+            return pos;
+        }
+    }
+}
+
+size_t HashTable::find(const Value &key, uint32_t hash) const
+{
+    size_t pos = find_slot(key, hash);
+    return pos == npos ? npos : m_slots[pos].m_entry;
 }
 
-Object *ListIter::call_method(Object *my, const std::string &name, [[maybe_unused]] const std::vector<Object *> &args)
+void HashTable::place(Slot slot)
 {
-    if (name == "_has_next_")
+    size_t mask = m_slots.size() - 1;
+
+    // a slot is taken from a key closer to its home, which is then placed further on
+    for (size_t pos = slot.m_hash & mask, dist = 0;; pos = (pos + 1) & mask, ++dist)
     {
-        return has_next(my);
+        if (m_slots[pos].m_entry == empty)
+        {
+            m_slots[pos] = slot;
+            return;
+        }
+
+        size_t other = probe_distance(pos);
+
+        if (other < dist)
+        {
+            swap(slot, m_slots[pos]);
+            dist = other;
+        }
     }
-    if (name == "_next_")
+}
+
+void HashTable::rebuild(size_t slot_count)
+{
+    size_t live = 0;
+
+    for (auto &e : m_entries)
     {
-        return next(my);
+        if (!e.m_removed)
+        {
+            m_entries[live++] = e;
+        }
     }
 
-    throw runtime_error(GC::instance().get_interp()->report_error("undefined method '" + name + "' in class " + get_name()));
+    m_entries.resize(live);
+    m_slots.assign(slot_count, Slot{0, empty});
+
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        place(Slot{m_entries[i].m_hash, static_cast<uint32_t>(i)});
+    }
 }
 
-void ListIter::check_method(const std::string &name, const std::vector<Object *> &args)
+size_t HashTable::insert(const Value &key, uint32_t hash, const Value &val)
 {
-    static unordered_map<string, size_t> methods = {{"_next_", 0}, {"_has_next_", 0}};
+    size_t found = find(key, hash);
 
-    auto it = methods.find(name);
+    if (found != npos)
+    {
+        m_entries[found].m_val = val;
+        return found;
+    }
 
-    if (it == methods.end())
+    // removed entries count towards the load, so they are dropped before the index fills up
+    if ((m_entries.size() + 1) * 8 > m_slots.size() * 7)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("name '" + name + "' is not defined in class " + get_name()));
+        size_t slot_count = 8;
+
+        while (slot_count < (m_count + 1) * 2)
+        {
+            slot_count *= 2;
+        }
+
+        rebuild(slot_count);
     }
 
-    if (it->second != args.size())
+    m_entries.push_back(Entry{key, val, hash, false});
+    place(Slot{hash, static_cast<uint32_t>(m_entries.size() - 1)});
+    ++m_count;
+
+    return m_entries.size() - 1;
+}
+
+bool HashTable::remove(const Value &key, uint32_t hash)
+{
+    size_t pos = find_slot(key, hash);
+
+    if (pos == npos)
     {
-        throw runtime_error(GC::instance().get_interp()->report_error("invalid number of arguments in method '" + name + "' in class " + get_name()));
+        return false;
     }
+
+    Entry &e = m_entries[m_slots[pos].m_entry];
+    e = Entry{Value(), Value(), 0, true};
+    --m_count;
+
+    // the following keys are shifted back, so no key is left behind an empty slot
+    size_t mask = m_slots.size() - 1;
+    size_t next = (pos + 1) & mask;
+
+    while (m_slots[next].m_entry != empty && probe_distance(next) > 0)
+    {
+        m_slots[pos] = m_slots[next];
+        pos = next;
+        next = (next + 1) & mask;
+    }
+
+    m_slots[pos] = Slot{0, empty};
+
+    return true;
+}
+
+void HashTable::clear()
+{
+    m_entries.clear();
+    m_slots.clear();
+    m_count = 0;
+}
+
+void HashTable::trace() const
+{
+    for (auto &e : m_entries)
+    {
+        e.m_key.mark();
+        e.m_val.mark();
+    }
+}
+
+/* Dict */
+
+const NativeType::Method Dict::methods[] = {{intern("len"), 0, len}, {intern("has"), 1, has}, {intern("get"), 2, get_or}, {intern("remove"), 1, remove}, {intern("keys"), 0, keys}, {intern("values"), 0, values}, {intern("clear"), 0, clear}, {intern("_iter_"), 0, iter}};
+
+uint32_t Dict::key_hash(const Value &key) const
+{
+    uint32_t res;
+
+    if (!HashTable::hash(key, res))
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid key type in " + get_name()));
+    }
+
+    return res;
+}
+
+Value Dict::get(Value key)
+{
+    size_t i = m_table.find(key, key_hash(key));
+
+    if (i == HashTable::npos)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid key in " + get_name()));
+    }
+
+    return m_table.m_entries[i].m_val;
+}
+
+void Dict::set(Value key, Value val)
+{
+    m_table.insert(key, key_hash(key), val);
+    GC::instance().write_barrier(this, key);
+    GC::instance().write_barrier(this, val);
+}
+
+string Dict::to_str() const
+{
+    string res = "{";
+    bool first = true;
+
+    for (auto &e : m_table.m_entries)
+    {
+        if (!e.m_removed)
+        {
+            res += first ? "" : ", ";
+            res += e.m_key.to_str();
+            res += ": ";
+            res += e.m_val.to_str();
+            first = false;
+        }
+    }
+
+    return res + "}";
+}
+
+bool Dict::equals(Object *other) const
+{
+    if (other->m_tag != ObjectType::Dict)
+    {
+        return false;
+    }
+
+    auto &table = static_cast<Dict *>(other)->m_table;
+
+    if (m_table.m_count != table.m_count)
+    {
+        return false;
+    }
+
+    for (auto &e : m_table.m_entries)
+    {
+        if (e.m_removed)
+        {
+            continue;
+        }
+
+        size_t i = table.find(e.m_key, e.m_hash);
+
+        if (i == HashTable::npos || !table.m_entries[i].m_val.equals(e.m_val))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Value Dict::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    Object *res = GC::instance().new_object(ObjectType::DictIter);
+    static_cast<DictIter *>(res)->m_dict = static_cast<Dict *>(my);
+    return res;
+}
+
+Value Dict::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    return Value::integer(static_cast<Dict *>(my)->m_table.m_count);
+}
+
+Value Dict::has(Object *my, const std::vector<Value> &args)
+{
+    auto dict = static_cast<Dict *>(my);
+
+    return Value::boolean(dict->m_table.find(args[0], dict->key_hash(args[0])) != HashTable::npos);
+}
+
+Value Dict::get_or(Object *my, const std::vector<Value> &args)
+{
+    auto dict = static_cast<Dict *>(my);
+    size_t i = dict->m_table.find(args[0], dict->key_hash(args[0]));
+
+    return i == HashTable::npos ? args[1] : dict->m_table.m_entries[i].m_val;
+}
+
+Value Dict::remove(Object *my, const std::vector<Value> &args)
+{
+    auto dict = static_cast<Dict *>(my);
+
+    return Value::boolean(dict->m_table.remove(args[0], dict->key_hash(args[0])));
+}
+
+Value Dict::keys(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto dict = static_cast<Dict *>(my);
+
+    Object *res = GC::instance().new_object(ObjectType::List);
+
+    for (auto &e : dict->m_table.m_entries)
+    {
+        if (!e.m_removed)
+        {
+            static_cast<List *>(res)->m_vals.push_back(e.m_key);
+        }
+    }
+
+    return res;
+}
+
+Value Dict::values(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto dict = static_cast<Dict *>(my);
+
+    Object *res = GC::instance().new_object(ObjectType::List);
+
+    for (auto &e : dict->m_table.m_entries)
+    {
+        if (!e.m_removed)
+        {
+            static_cast<List *>(res)->m_vals.push_back(e.m_val);
+        }
+    }
+
+    return res;
+}
+
+Value Dict::clear(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    static_cast<Dict *>(my)->m_table.clear();
+
+    return nullptr;
+}
+
+void Dict::trace()
+{
+    m_table.trace();
+}
+
+/* DictIter */
+
+const NativeType::Method DictIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
+
+Value DictIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<DictIter *>(my);
+    auto &table = it->m_dict->m_table;
+
+    return Value::boolean(table.next(it->m_pos) < table.m_entries.size());
+}
+
+Value DictIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<DictIter *>(my);
+    auto &table = it->m_dict->m_table;
+
+    it->m_pos = table.next(it->m_pos);
+
+    if (it->m_pos >= table.m_entries.size())
+    {
+        return nullptr;
+    }
+
+    return table.m_entries[it->m_pos++].m_key;
+}
+
+void DictIter::trace()
+{
+    GC::instance().shade(m_dict);
+}
+
+/* Set */
+
+const NativeType::Method Set::methods[] = {{intern("len"), 0, len}, {intern("has"), 1, has}, {intern("add"), 1, put}, {intern("remove"), 1, remove}, {intern("clear"), 0, clear}, {intern("_iter_"), 0, iter}};
+
+uint32_t Set::key_hash(const Value &key) const
+{
+    uint32_t res;
+
+    if (!HashTable::hash(key, res))
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid element type in " + get_name()));
+    }
+
+    return res;
+}
+
+void Set::add(const Value &key)
+{
+    m_table.insert(key, key_hash(key), Value());
+    GC::instance().write_barrier(this, key);
+}
+
+Value Set::get(Value key)
+{
+    return Value::boolean(m_table.find(key, key_hash(key)) != HashTable::npos);
+}
+
+void Set::set(Value key, Value val)
+{
+    if (tag_of(val) != ObjectType::Bool)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid value type in " + get_name()));
+    }
+
+    if (val.m_bool)
+    {
+        add(key);
+    }
+    else
+    {
+        m_table.remove(key, key_hash(key));
+    }
+}
+
+string Set::to_str() const
+{
+    string res = "{";
+    bool first = true;
+
+    for (auto &e : m_table.m_entries)
+    {
+        if (!e.m_removed)
+        {
+            res += first ? "" : ", ";
+            res += e.m_key.to_str();
+            first = false;
+        }
+    }
+
+    return res + "}";
+}
+
+bool Set::equals(Object *other) const
+{
+    if (other->m_tag != ObjectType::Set)
+    {
+        return false;
+    }
+
+    auto &table = static_cast<Set *>(other)->m_table;
+
+    if (m_table.m_count != table.m_count)
+    {
+        return false;
+    }
+
+    for (auto &e : m_table.m_entries)
+    {
+        if (!e.m_removed && table.find(e.m_key, e.m_hash) == HashTable::npos)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Value Set::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    Object *res = GC::instance().new_object(ObjectType::SetIter);
+    static_cast<SetIter *>(res)->m_set = static_cast<Set *>(my);
+    return res;
+}
+
+Value Set::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    return Value::integer(static_cast<Set *>(my)->m_table.m_count);
+}
+
+Value Set::has(Object *my, const std::vector<Value> &args)
+{
+    return static_cast<Set *>(my)->get(args[0]);
+}
+
+Value Set::put(Object *my, const std::vector<Value> &args)
+{
+    static_cast<Set *>(my)->add(args[0]);
+
+    return nullptr;
+}
+
+Value Set::remove(Object *my, const std::vector<Value> &args)
+{
+    auto set = static_cast<Set *>(my);
+
+    return Value::boolean(set->m_table.remove(args[0], set->key_hash(args[0])));
+}
+
+Value Set::clear(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    static_cast<Set *>(my)->m_table.clear();
+
+    return nullptr;
+}
+
+void Set::trace()
+{
+    m_table.trace();
+}
+
+/* SetIter */
+
+const NativeType::Method SetIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
+
+Value SetIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<SetIter *>(my);
+    auto &table = it->m_set->m_table;
+
+    return Value::boolean(table.next(it->m_pos) < table.m_entries.size());
+}
+
+Value SetIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<SetIter *>(my);
+    auto &table = it->m_set->m_table;
+
+    it->m_pos = table.next(it->m_pos);
+
+    if (it->m_pos >= table.m_entries.size())
+    {
+        return nullptr;
+    }
+
+    return table.m_entries[it->m_pos++].m_key;
+}
+
+void SetIter::trace()
+{
+    GC::instance().shade(m_set);
+}
+
+/* Array */
+
+template <typename T>
+const NativeType::Method Array<T>::methods[] = {{intern("len"), 0, len}, {intern("put"), 1, put}, {intern("sum"), 0, sum}, {intern("min"), 0, min}, {intern("max"), 0, max}, {intern("dot"), 1, dot}, {intern("scale"), 1, scale}, {intern("add"), 1, add}, {intern("to_list"), 0, to_list}, {intern("_iter_"), 0, iter}};
+
+template <typename T>
+Value Array<T>::create(const Value &init)
+{
+    if (tag_of(init) == ObjectType::Int && init.m_int >= 0)
+    {
+        auto res = static_cast<Array *>(GC::instance().new_object(tag));
+        res->m_vals.resize(init.m_int);
+        return res;
+    }
+
+    if (tag_of(init) == ObjectType::List)
+    {
+        auto &vals = static_cast<List *>(init.m_obj)->m_vals;
+        auto res = static_cast<Array *>(GC::instance().new_object(tag));
+        res->m_vals.resize(vals.size());
+
+        for (size_t i = 0; i < vals.size(); ++i)
+        {
+            if (!from_value(vals[i], res->m_vals[i]))
+            {
+                throw runtime_error(GC::instance().get_interp()->report_error("invalid element type in fun '" + string(type_name()) + "'"));
+            }
+        }
+
+        return res;
+    }
+
+    throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in fun '" + string(type_name()) + "'"));
+}
+
+template <typename T>
+bool Array<T>::from_value(const Value &v, T &res)
+{
+    if (tag_of(v) == ObjectType::Int)
+    {
+        res = v.m_int;
+        return true;
+    }
+
+    if constexpr (tag == ObjectType::FloatArray)
+    {
+        if (tag_of(v) == ObjectType::Float)
+        {
+            res = v.m_float;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename T>
+Value Array<T>::get(Value index)
+{
+    if (tag_of(index) == ObjectType::Int)
+    {
+        long long i = index.m_int;
+
+        if (i < 0 || i > int(m_vals.size() - 1))
+        {
+            throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
+        }
+
+        return to_value(m_vals[i]);
+    }
+
+    throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
+}
+
+template <typename T>
+void Array<T>::set(Value index, Value val)
+{
+    if (tag_of(index) == ObjectType::Int)
+    {
+        long long i = index.m_int;
+
+        if (i < 0 || i > int(m_vals.size() - 1))
+        {
+            throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
+        }
+
+        if (!from_value(val, m_vals[i]))
+        {
+            throw runtime_error(GC::instance().get_interp()->report_error("invalid value type in " + get_name()));
+        }
+
+        return;
+    }
+
+    throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
+}
+
+template <typename T>
+string Array<T>::to_str() const
+{
+    string res = "[";
+    bool first = true;
+
+    for (auto val : m_vals)
+    {
+        res += first ? "" : ", ";
+        res += to_value(val).to_str();
+        first = false;
+    }
+
+    res += "]";
+
+    return res;
+}
+
+template <typename T>
+Value Array<T>::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    Object *res = GC::instance().new_object(ObjectType::ArrayIter);
+    static_cast<ArrayIter *>(res)->m_array = my;
+    return res;
+}
+
+template <typename T>
+Value Array<T>::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    return Value::integer(static_cast<Array *>(my)->m_vals.size());
+}
+
+template <typename T>
+Value Array<T>::put(Object *my, const std::vector<Value> &args)
+{
+    T val;
+
+    if (!from_value(args[0], val))
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in method 'put' in class " + string(type_name())));
+    }
+
+    static_cast<Array *>(my)->m_vals.push_back(val);
+
+    return nullptr;
+}
+
+template <typename T>
+Value Array<T>::sum(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+
+    return to_value(simd::sum(vals.data(), vals.size()));
+}
+
+template <typename T>
+Value Array<T>::min(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+
+    if (vals.empty())
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'min'"));
+    }
+
+    return to_value(simd::min(vals.data(), vals.size()));
+}
+
+template <typename T>
+Value Array<T>::max(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+
+    if (vals.empty())
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("attempt to access an element in an empty container in 'max'"));
+    }
+
+    return to_value(simd::max(vals.data(), vals.size()));
+}
+
+// the other operand of dot() and add(): an array of the same type and length
+template <typename T>
+static const std::vector<T> &operand(Object *my, const Value &other, const char *method)
+{
+    auto &vals = static_cast<Array<T> *>(my)->m_vals;
+
+    if (tag_of(other) != Array<T>::tag)
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in method '" + string(method) + "' in class " + Array<T>::type_name()));
+    }
+
+    auto &other_vals = static_cast<Array<T> *>(other.m_obj)->m_vals;
+
+    if (other_vals.size() != vals.size())
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("arrays of different lengths in method '" + string(method) + "' in class " + Array<T>::type_name()));
+    }
+
+    return other_vals;
+}
+
+template <typename T>
+Value Array<T>::dot(Object *my, const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+    auto &other = operand<T>(my, args[0], "dot");
+
+    return to_value(simd::dot(vals.data(), other.data(), vals.size()));
+}
+
+template <typename T>
+Value Array<T>::scale(Object *my, const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+    T k;
+
+    if (!from_value(args[0], k))
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("invalid argument type in method 'scale' in class " + string(type_name())));
+    }
+
+    simd::scale(vals.data(), vals.size(), k);
+
+    return nullptr;
+}
+
+template <typename T>
+Value Array<T>::add(Object *my, const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+    auto &other = operand<T>(my, args[0], "add");
+
+    simd::add(vals.data(), other.data(), vals.size());
+
+    return nullptr;
+}
+
+template <typename T>
+Value Array<T>::to_list(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto &vals = static_cast<Array *>(my)->m_vals;
+    auto res = static_cast<List *>(GC::instance().new_object(ObjectType::List));
+    res->m_vals.reserve(vals.size());
+
+    for (auto val : vals)
+    {
+        res->m_vals.push_back(to_value(val));
+    }
+
+    return res;
+}
+
+template struct halo::Array<long long>;
+template struct halo::Array<double>;
+
+/* ArrayIter */
+
+const NativeType::Method ArrayIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
+
+Value ArrayIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<ArrayIter *>(my);
+    size_t size = it->m_array->m_tag == ObjectType::IntArray ? static_cast<IntArray *>(it->m_array)->m_vals.size()
+                                                             : static_cast<FloatArray *>(it->m_array)->m_vals.size();
+
+    return Value::boolean(it->m_pos < size);
+}
+
+Value ArrayIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<ArrayIter *>(my);
+
+    if (it->m_array->m_tag == ObjectType::IntArray)
+    {
+        auto &vals = static_cast<IntArray *>(it->m_array)->m_vals;
+        return it->m_pos < vals.size() ? Value::integer(vals[it->m_pos++]) : Value(nullptr);
+    }
+
+    auto &vals = static_cast<FloatArray *>(it->m_array)->m_vals;
+    return it->m_pos < vals.size() ? Value::floating(vals[it->m_pos++]) : Value(nullptr);
+}
+
+void ArrayIter::trace()
+{
+    GC::instance().shade(m_array);
+}
+
+/* Range */
+
+const NativeType::Method Range::methods[] = {{intern("len"), 0, len}, {intern("_iter_"), 0, iter}};
+
+Value Range::create(const Value &begin, const Value &end, const Value &step)
+{
+    Interpreter *interp = GC::instance().get_interp();
+
+    if (tag_of(begin) != ObjectType::Int)
+    {
+        throw runtime_error(interp->report_error("first index in range must be an integer"));
+    }
+    if (tag_of(end) != ObjectType::Int)
+    {
+        throw runtime_error(interp->report_error("last index in range must be an integer"));
+    }
+    if (tag_of(step) != ObjectType::Int)
+    {
+        throw runtime_error(interp->report_error("step in range must be an integer"));
+    }
+
+    if (step.m_int == 0)
+    {
+        throw runtime_error(interp->report_error("step in range must not be 0"));
+    }
+
+    Range *res = static_cast<Range *>(GC::instance().new_object(ObjectType::Range));
+    res->m_begin = begin.m_int;
+    res->m_end = end.m_int;
+    res->m_step = step.m_int;
+    return res;
+}
+
+unsigned long long Range::length(long long begin, long long end, long long step)
+{
+    if (step > 0)
+    {
+        return begin < end ? (static_cast<unsigned long long>(end) - begin - 1) / step + 1 : 0;
+    }
+
+    return begin > end ? (static_cast<unsigned long long>(begin) - end - 1) / (0ull - step) + 1 : 0;
+}
+
+Value Range::get(Value index)
+{
+    if (tag_of(index) == ObjectType::Int)
+    {
+        long long i = index.m_int;
+
+        if (i < 0 || static_cast<unsigned long long>(i) >= size())
+        {
+            throw runtime_error(GC::instance().get_interp()->report_error("invalid index in " + get_name()));
+        }
+
+        return Value::integer(static_cast<unsigned long long>(m_begin) + static_cast<unsigned long long>(i) * m_step);
+    }
+
+    throw runtime_error(GC::instance().get_interp()->report_error("invalid index value type in " + get_name()));
+}
+
+void Range::set(Value, Value)
+{
+    throw std::runtime_error(GC::instance().get_interp()->report_error("set operation is not available for type " + get_name()));
+}
+
+string Range::to_str() const
+{
+    return "range(" + to_string(m_begin) + ", " + to_string(m_end) + ", " + to_string(m_step) + ")";
+}
+
+bool Range::equals(Object *other) const
+{
+    if (other->m_tag != ObjectType::Range)
+    {
+        return false;
+    }
+
+    // ranges are equal when they have the same integers, however they were written
+    auto r = static_cast<Range *>(other);
+    unsigned long long n = size();
+
+    return n == r->size() && (n == 0 || (m_begin == r->m_begin && (n == 1 || m_step == r->m_step)));
+}
+
+Value Range::iter(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto range = static_cast<Range *>(my);
+
+    RangeIter *res = static_cast<RangeIter *>(GC::instance().new_object(ObjectType::RangeIter));
+    res->m_next = range->m_begin;
+    res->m_step = range->m_step;
+    res->m_left = range->size();
+    return res;
+}
+
+Value Range::len(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto range = static_cast<Range *>(my);
+    unsigned long long n = range->size();
+
+    // a range over most of the ints has more of them than an int can hold
+    if (n > static_cast<unsigned long long>(LLONG_MAX))
+    {
+        throw runtime_error(GC::instance().get_interp()->report_error("length too large in method 'len' in class " + range->get_name()));
+    }
+
+    return Value::integer(n);
+}
+
+/* RangeIter */
+
+const NativeType::Method RangeIter::methods[] = {{intern("_has_next_"), 0, has_next}, {intern("_next_"), 0, next}};
+
+Value RangeIter::has_next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    return Value::boolean(static_cast<RangeIter *>(my)->m_left != 0);
+}
+
+Value RangeIter::next(Object *my, [[maybe_unused]] const std::vector<Value> &args)
+{
+    auto it = static_cast<RangeIter *>(my);
+
+    if (it->m_left == 0)
+    {
+        return nullptr;
+    }
+
+    Value res = Value::integer(it->m_next);
+    it->m_next = static_cast<unsigned long long>(it->m_next) + it->m_step;
+    --it->m_left;
+    return res;
 }
\ No newline at end of file
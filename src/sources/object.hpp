@@ -1,24 +1,207 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <stdexcept>
 #include <map>
 #include <iostream>
 
+#include "symbol.hpp"
+
 namespace halo
 {
     struct ClassBase;
+    struct Dict;
+    struct Set;
+
+// every object type in the order of ObjectType, by where its objects live: VALUE types are stored
+// unboxed in Value, CALLABLE ones are allocated by new, and each POOLED type has a pool in the GC,
+// of objects of the C++ type of the same name; the GC generates its allocation and sweeping from it
+#define HALO_OBJECT_TYPES(VALUE, CALLABLE, POOLED) \
+    VALUE(Null)                                    \
+    VALUE(Int)                                     \
+    VALUE(Float)                                   \
+    VALUE(Bool)                                    \
+    POOLED(Object)                                 \
+    POOLED(String)                                 \
+    POOLED(StringIter)                             \
+    CALLABLE(Callable)                             \
+    POOLED(List)                                   \
+    POOLED(ListIter)                               \
+    POOLED(StringBuilder)                          \
+    POOLED(Dict)                                   \
+    POOLED(DictIter)                               \
+    POOLED(Set)                                    \
+    POOLED(SetIter)                                \
+    POOLED(IntArray)                               \
+    POOLED(FloatArray)                             \
+    POOLED(ArrayIter)                              \
+    POOLED(Range)                                  \
+    POOLED(RangeIter)
+
+#define HALO_OBJECT_TYPE_ENUMERATOR(name) name,
+#define HALO_OBJECT_TYPE_ONE(name) +1
+
+    enum class ObjectType
+    {
+        HALO_OBJECT_TYPES(HALO_OBJECT_TYPE_ENUMERATOR, HALO_OBJECT_TYPE_ENUMERATOR, HALO_OBJECT_TYPE_ENUMERATOR)
+    };
+
+    constexpr size_t object_type_count = 0 HALO_OBJECT_TYPES(HALO_OBJECT_TYPE_ONE, HALO_OBJECT_TYPE_ONE, HALO_OBJECT_TYPE_ONE);
+
+    struct Object;
+
+    // the field layout shared by the instances of a class: the field named m_names[i]
+    // is stored in slot i of an instance; the names are sorted, which also orders to_str()
+    struct Shape
+    {
+        static constexpr size_t npos = SIZE_MAX;
+
+        std::vector<Symbol> m_names;
+
+        Shape(const std::vector<std::string> &names = {})
+        {
+            for (auto &name : names)
+            {
+                m_names.push_back(intern(name));
+            }
+
+            std::sort(m_names.begin(), m_names.end(), [](Symbol a, Symbol b)
+                      { return *a < *b; });
+        }
+
+        // a binary search over the names sorted by their text: equal texts are interned
+        // to the same symbol, so the name it stops at is compared by pointer
+        size_t find(Symbol name) const
+        {
+            auto it = std::lower_bound(m_names.begin(), m_names.end(), name, [](Symbol a, Symbol b)
+                                       { return *a < *b; });
+            return it != m_names.end() && *it == name ? it - m_names.begin() : npos;
+        }
+    };
+
+    // the inline cache of a field access site: the slots the field was found at for
+    // the last few shapes seen there, so a hit compares pointers instead of names
+    struct FieldCache
+    {
+        static constexpr size_t size = 4;
+
+        const Shape *m_shapes[size] = {};
+        size_t m_slots[size] = {};
+        // the entry to replace next once the site sees more than size shapes
+        size_t m_next = 0;
+
+        size_t find(const Shape *shape, Symbol name)
+        {
+            if (!shape)
+            {
+                return Shape::npos;
+            }
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (m_shapes[i] == shape)
+                {
+                    return m_slots[i];
+                }
+            }
+
+            size_t slot = shape->find(name);
+
+            if (slot != Shape::npos)
+            {
+                m_shapes[m_next] = shape;
+                m_slots[m_next] = slot;
+                m_next = (m_next + 1) % size;
+            }
+
+            return slot;
+        }
+    };
+
+    // null, ints, floats and bools are stored right in the value,
+    // only the other types are allocated on the GC heap and referenced through m_obj
+    struct Value
+    {
+        ObjectType m_tag;
+
+        union
+        {
+            long long m_int;
+            double m_float;
+            bool m_bool;
+            Object *m_obj;
+        };
+
+        Value(Object *obj = nullptr);
+
+        static Value integer(long long val)
+        {
+            Value v;
+            v.m_tag = ObjectType::Int;
+            v.m_int = val;
+            return v;
+        }
+
+        static Value floating(double val)
+        {
+            Value v;
+            v.m_tag = ObjectType::Float;
+            v.m_float = val;
+            return v;
+        }
+
+        static Value boolean(bool val)
+        {
+            Value v;
+            v.m_tag = ObjectType::Bool;
+            v.m_bool = val;
+            return v;
+        }
+
+        bool is_null() const
+        {
+            return m_tag == ObjectType::Null;
+        }
+
+        bool is_object() const
+        {
+            return m_tag > ObjectType::Bool;
+        }
+
+        Object *as_object() const
+        {
+            return is_object() ? m_obj : nullptr;
+        }
+
+        std::string to_str() const;
+        bool equals(const Value &other) const;
+        // shades the referenced object, see GC::shade()
+        void mark() const;
+    };
 
     struct Object
     {
         ClassBase *m_type;
-        std::map<std::string, Object *> m_fields;
-        bool m_marked = false;
+        // the fields of a class instance, laid out by m_shape, which is null for other objects
+        const Shape *m_shape = nullptr;
+        std::vector<Value> m_slots;
+        ObjectType m_tag;
+        // marked when equal to the current epoch of the GC, atomic for the parallel marker
+        std::atomic<bool> m_marked{false};
         bool m_eternal = false;
+        // survived a collection and was promoted out of the nursery
+        bool m_old = false;
+        // young object that is in the remembered set of the GC
+        bool m_remembered = false;
 
-        Object(ClassBase *type = nullptr)
-            : m_type(type)
+        Object(ClassBase *type = nullptr, ObjectType tag = ObjectType::Object)
+            : m_type(type), m_tag(tag)
         {
         }
 
@@ -28,244 +211,367 @@ namespace halo
 
         virtual std::string to_str() const;
 
-        void set_field(const std::string &name, Object *val);
-        Object *get_field(const std::string &name);
+        // the shape is set and the slots are allocated, all null, before the object is used
+        void set_shape(const Shape *shape)
+        {
+            m_shape = shape;
+            m_slots.assign(shape->m_names.size(), Value());
+        }
+
+        void set_field(Symbol name, Value val);
+        Value get_field(Symbol name);
+        void set_field(Symbol name, Value val, FieldCache &cache);
+        Value get_field(Symbol name, FieldCache &cache);
+        [[noreturn]] static void field_error(Symbol name);
 
-        Object *call_method(const std::string &name, const std::vector<Object *> &args);
+        Value call_method(Symbol name, const std::vector<Value> &args);
 
         virtual bool equals(Object *other) const
         {
             return this == other;
         }
 
-        virtual void mark();
+        // shades every object this one references
+        virtual void trace();
     };
 
-    struct Int : Object
+    inline Value::Value(Object *obj)
+        : m_tag(obj ? obj->m_tag : ObjectType::Null), m_obj(obj)
     {
-        long long m_val;
+    }
 
-        Int()
-            : Object(nullptr), m_val(0)
+    inline bool Value::equals(const Value &other) const
+    {
+        if (m_tag != other.m_tag)
         {
+            return false;
         }
 
-        std::string to_str() const override;
-
-        bool equals(Object *other) const override
+        switch (m_tag)
         {
-            Int *p = dynamic_cast<Int *>(other);
+        case ObjectType::Null:
+            return true;
+        case ObjectType::Int:
+            return m_int == other.m_int;
+        case ObjectType::Float:
+            return m_float == other.m_float;
+        case ObjectType::Bool:
+            return m_bool == other.m_bool;
+        default:
+            return m_obj->equals(other.m_obj);
+        }
+    }
 
-            if (!p)
-            {
-                return false;
-            }
+    inline ObjectType tag_of(const Value &v)
+    {
+        return v.m_tag;
+    }
 
-            return m_val == p->m_val;
+    // an interface rather than a base, so that Object is a plain non-virtual base of every object
+    struct Indexable
+    {
+        virtual ~Indexable()
+        {
         }
 
-        void mark() override;
+        virtual Value get(Value index) = 0;
+        virtual void set(Value index, Value val) = 0;
     };
 
-    struct Float : Object
+    struct Callable : Object
     {
-        double m_val;
+        // the size of the concrete type, set by the GC for the statistics
+        size_t m_size = 0;
 
-        Float()
-            : Object(nullptr), m_val(0)
+        Callable(ObjectType tag = ObjectType::Callable)
+            : Object(nullptr, tag)
         {
         }
 
-        std::string to_str() const override;
+        virtual Value call([[maybe_unused]] const std::vector<Value> &args);
 
-        bool equals(Object *other) const override
-        {
-            Float *p = dynamic_cast<Float *>(other);
+        virtual int arity() const;
 
-            if (!p)
-            {
-                return false;
-            }
+        virtual std::string debug_info() const;
+    };
 
-            return m_val == p->m_val;
+    // every type deriving from Callable has one of these tags
+    inline Callable *as_callable(const Value &v)
+    {
+        switch (v.m_tag)
+        {
+        case ObjectType::Callable:
+        case ObjectType::String:
+        case ObjectType::StringIter:
+        case ObjectType::List:
+        case ObjectType::ListIter:
+        case ObjectType::StringBuilder:
+        case ObjectType::Dict:
+        case ObjectType::DictIter:
+        case ObjectType::Set:
+        case ObjectType::SetIter:
+        case ObjectType::IntArray:
+        case ObjectType::FloatArray:
+        case ObjectType::ArrayIter:
+        case ObjectType::Range:
+        case ObjectType::RangeIter:
+            return static_cast<Callable *>(v.m_obj);
+        default:
+            return nullptr;
         }
+    }
+
+    using NativeMethod = Value (*)(Object *my, const std::vector<Value> &args);
 
-        void mark() override;
+    // the inline cache of a method call site: the method the name resolved to
+    // for the last type of receiver seen there, see ClassBase::resolve_method()
+    struct MethodCache
+    {
+        const void *m_key = nullptr;
+        size_t m_index = 0;
+        size_t m_arity = 0;
+        // set for a builtin method, which is then called directly
+        NativeMethod m_native = nullptr;
     };
 
-    struct Bool : Object
+    struct ClassBase : Callable
     {
-        bool m_val;
+        static constexpr size_t no_method = SIZE_MAX;
+
+        // types with the same key have the same methods under the same indices; the key outlives
+        // every call site, so caches compare it instead of the type, which may be collected and reused
+        const void *m_method_key = nullptr;
 
-        Bool()
-            : Object(nullptr), m_val(0)
+        ClassBase(ObjectType tag = ObjectType::Callable)
+            : Callable(tag)
         {
         }
 
-        std::string to_str() const override;
+        virtual Value call_method(Object *my, Symbol name, const std::vector<Value> &args) = 0;
+        virtual void check_method(Symbol name, const std::vector<Value> &args) = 0;
+        virtual std::string get_name() const = 0;
 
-        bool equals(Object *other) const override
+        // the index of a method, valid for every type with the same m_method_key
+        virtual size_t find_method([[maybe_unused]] Symbol name) const
         {
-            Bool *p = dynamic_cast<Bool *>(other);
+            return no_method;
+        }
 
-            if (!p)
+        virtual size_t method_arity([[maybe_unused]] size_t index) const
+        {
+            return 0;
+        }
+
+        virtual NativeMethod native_method([[maybe_unused]] size_t index) const
+        {
+            return nullptr;
+        }
+
+        virtual Value call_method_at([[maybe_unused]] Object *my, [[maybe_unused]] size_t index, [[maybe_unused]] const std::vector<Value> &args)
+        {
+            return nullptr;
+        }
+
+        // checks the call like check_method(), but looks the name up only when the cache misses
+        void resolve_method(Symbol name, const std::vector<Value> &args, MethodCache &cache)
+        {
+            if (m_method_key && cache.m_key == m_method_key && cache.m_arity == args.size())
             {
-                return false;
+                return;
             }
 
-            return m_val == p->m_val;
+            check_method(name, args);
+
+            size_t index = find_method(name);
+            cache = {m_method_key, index, method_arity(index), native_method(index)};
         }
 
-        void mark() override;
+        // calls the method resolve_method() put into the cache
+        Value call_cached(Object *my, const MethodCache &cache, const std::vector<Value> &args)
+        {
+            return cache.m_native ? cache.m_native(my, args) : call_method_at(my, cache.m_index, args);
+        }
     };
 
-    struct Indexable : virtual Object
+    // a builtin type, whose methods are listed in a static table
+    struct NativeType : ClassBase
     {
-        Indexable()
-            : Object(nullptr)
+        struct Method
         {
-        }
+            Symbol m_name;
+            size_t m_arity;
+            NativeMethod m_fn;
+        };
 
-        virtual Object *get(Object *index) = 0;
-        virtual void set(Object *index, Object *val) = 0;
-    };
+        const Method *m_methods;
+        size_t m_method_count;
 
-    struct Callable : virtual Object
-    {
-        Callable()
-            : Object(nullptr)
+        template <size_t N>
+        NativeType(ObjectType tag, const Method (&methods)[N])
+            : ClassBase(tag), m_methods(methods), m_method_count(N)
         {
+            m_type = this;
+            m_method_key = methods;
         }
 
-        virtual Object *call([[maybe_unused]] const std::vector<Object *> &args);
+        Value call_method(Object *my, Symbol name, const std::vector<Value> &args) override;
+        void check_method(Symbol name, const std::vector<Value> &args) override;
 
-        virtual int arity() const;
+        size_t find_method(Symbol name) const override;
 
-        virtual std::string debug_info() const;
-    };
+        size_t method_arity(size_t index) const override
+        {
+            return m_methods[index].m_arity;
+        }
 
-    struct ClassBase : Callable
-    {
-        virtual Object *call_method(Object *my, const std::string &name, const std::vector<Object *> &args) = 0;
-        virtual void check_method(const std::string &name, const std::vector<Object *> &args) = 0;
-        virtual std::string get_name() const = 0;
+        NativeMethod native_method(size_t index) const override
+        {
+            return m_methods[index].m_fn;
+        }
     };
 
-    struct StringIter : ClassBase
+    struct String;
+
+    struct StringIter : NativeType
     {
-        std::string::const_iterator m_beg;
-        std::string::const_iterator m_end;
+        static const Method methods[2];
+
+        // indices rather than iterators, since the buffer of the string may grow while it is iterated
+        String *m_str = nullptr;
+        size_t m_pos = 0;
 
         StringIter()
+            : NativeType(ObjectType::StringIter, methods)
         {
-            m_type = this;
         }
 
-        Object *has_next(Object *my);
-        Object *next(Object *my);
-
-        Object *call_method(Object *my, const std::string &name, [[maybe_unused]] const std::vector<Object *> &args) override;
-        void check_method(const std::string &name, const std::vector<Object *> &args) override;
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
 
         std::string get_name() const override
         {
             return "StringIter";
         }
 
-        void mark() override;
+        void trace() override;
     };
 
-    struct String : Indexable, ClassBase
+    struct String : NativeType, Indexable
     {
+        static const Method methods[2];
+
+        // a concatenation result at least this long is built in a buffer that later concatenations may extend
+        static constexpr size_t min_shared = 64;
+        // a substring at least this long shares the characters of its string, a shorter one is copied
+        static constexpr size_t min_view = 16;
+
+        // the characters of a string that owns them; a string with m_base is a view:
+        // it shares the characters of m_base, which owns them, and is m_len of them from m_offset
         std::string m_val;
+        String *m_base = nullptr;
+        size_t m_offset = 0;
+        size_t m_len = 0;
+        // the string is not visible to the script, but is the buffer of views made by concat(),
+        // which may append to it
+        bool m_buffer = false;
 
         String()
-            : Indexable()
+            : NativeType(ObjectType::String, methods)
         {
-            m_type = this;
         }
 
-        Object *get(Object *index) override;
-        void set(Object *, Object *) override;
+        // valid until the next concatenation
+        std::string_view view() const
+        {
+            return m_base ? std::string_view(m_base->m_val.data() + m_offset, m_len) : std::string_view(m_val);
+        }
+
+        Value get(Value index) override;
+        void set(Value, Value) override;
 
         std::string to_str() const override;
 
         bool equals(Object *other) const override
         {
-            String *p = dynamic_cast<String *>(other);
-
-            if (!p)
+            if (other->m_tag != ObjectType::String)
             {
                 return false;
             }
 
-            return m_val == p->m_val;
+            return view() == static_cast<String *>(other)->view();
         }
 
-        Object *iter(Object *my);
-
-        Object *call_method(Object *my, const std::string &name, const std::vector<Object *> &args) override;
-        void check_method(const std::string &name, const std::vector<Object *> &args) override;
+        static Value iter(Object *my, const std::vector<Value> &args);
 
         std::string get_name() const override
         {
             return "String";
         }
 
-        Object *substr(Object *my, const std::vector<Object *> &args);
+        static Value substr(Object *my, const std::vector<Value> &args);
 
-        void mark() override;
+        static Value concat(String *left, String *right);
+        static Value substring(String *str, size_t pos, size_t len);
+        // the string of a single character, which is shared rather than allocated
+        static String *of_char(char c);
+
+        void trace() override;
     };
 
-    struct ListIter : ClassBase
+    struct List;
+
+    struct ListIter : NativeType
     {
-        std::vector<Object *>::const_iterator m_beg;
-        std::vector<Object *>::const_iterator m_end;
+        static const Method methods[2];
+
+        // indices rather than iterators, since the buffer of the list may grow while it is iterated;
+        // the elements put while it is iterated are not visited
+        List *m_list = nullptr;
+        size_t m_pos = 0;
+        size_t m_end = 0;
 
         ListIter()
+            : NativeType(ObjectType::ListIter, methods)
         {
-            m_type = this;
         }
 
-        Object *has_next(Object *my);
-        Object *next(Object *my);
-
-        Object *call_method(Object *my, const std::string &name, [[maybe_unused]] const std::vector<Object *> &args) override;
-        void check_method(const std::string &name, const std::vector<Object *> &args) override;
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
 
         std::string get_name() const override
         {
-            return "StringIter";
+            return "ListIter";
         }
 
-        void mark() override;
+        void trace() override;
     };
 
-    struct List : Indexable, ClassBase
+    struct List : NativeType, Indexable
     {
-        std::vector<Object *> m_vals;
+        static const Method methods[7];
+
+        std::vector<Value> m_vals;
 
         List()
-            : Indexable()
+            : NativeType(ObjectType::List, methods)
         {
-            m_type = this;
         }
 
-        Object *get(Object *index) override;
+        Value get(Value index) override;
 
-        void set(Object *index, Object *val) override;
+        void set(Value index, Value val) override;
 
         std::string to_str() const override;
 
         bool equals(Object *other) const override
         {
-            List *p = dynamic_cast<List *>(other);
-
-            if (!p)
+            if (other->m_tag != ObjectType::List)
             {
                 return false;
             }
 
+            List *p = static_cast<List *>(other);
+
             if (m_vals.size() != p->m_vals.size())
             {
                 return false;
@@ -273,7 +579,7 @@ namespace halo
 
             for (size_t i = 0; i < m_vals.size(); ++i)
             {
-                if (!m_vals[i]->equals(p->m_vals[i]))
+                if (!m_vals[i].equals(p->m_vals[i]))
                 {
                     return false;
                 }
@@ -282,47 +588,412 @@ namespace halo
             return true;
         }
 
-        Object *iter(Object *my);
+        std::string get_name() const override
+        {
+            return "List";
+        }
+
+        static Value iter(Object *my, const std::vector<Value> &args);
+        static Value put(Object *my, const std::vector<Value> &args);
+        static Value pop(Object *my, const std::vector<Value> &args);
+        static Value pop_at(Object *my, const std::vector<Value> &args);
+        static Value pop_all(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+        static Value clear(Object *my, const std::vector<Value> &args);
+
+        void trace() override;
+    };
+
+    // accumulates text in place, for the scripts that would otherwise build a string by repeated concatenation
+    struct StringBuilder : NativeType
+    {
+        static const Method methods[4];
 
-        Object *call_method(Object *my, const std::string &name, const std::vector<Object *> &args) override;
-        void check_method(const std::string &name, const std::vector<Object *> &args) override;
+        std::string m_buf;
+
+        StringBuilder()
+            : NativeType(ObjectType::StringBuilder, methods)
+        {
+        }
+
+        std::string to_str() const override
+        {
+            return m_buf;
+        }
 
         std::string get_name() const override
         {
-            return "List";
+            return "StringBuilder";
+        }
+
+        static Value append(Object *my, const std::vector<Value> &args);
+        static Value build(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+        static Value clear(Object *my, const std::vector<Value> &args);
+    };
+
+    // the table behind Dict and Set: the entries are kept in the order they were added in,
+    // which is also the order of iteration, and are found through an open addressing index
+    // with Robin Hood probing; an index slot holds the hash of its entry, so a probe
+    // rarely needs to look at an entry whose key is not the one searched for
+    //
+    // a removed entry stays in place until the table is rebuilt by an insertion,
+    // so removing keys while the table is iterated does not move the other entries
+    struct HashTable
+    {
+        static constexpr size_t npos = SIZE_MAX;
+
+        struct Entry
+        {
+            Value m_key;
+            Value m_val;
+            uint32_t m_hash;
+            bool m_removed;
+        };
+
+        std::vector<Entry> m_entries;
+        size_t m_count = 0;
+
+        // the hash of a key, false for a type that cannot be a key
+        static bool hash(const Value &key, uint32_t &res);
+
+        // the index of the entry of key, or npos
+        size_t find(const Value &key, uint32_t hash) const;
+        // adds the entry of key or replaces its value, returns the index of the entry
+        size_t insert(const Value &key, uint32_t hash, const Value &val);
+        bool remove(const Value &key, uint32_t hash);
+        void clear();
+
+        // the index of the first entry at or after pos that is not removed
+        size_t next(size_t pos) const
+        {
+            while (pos < m_entries.size() && m_entries[pos].m_removed)
+            {
+                ++pos;
+            }
+
+            return pos;
+        }
+
+        void trace() const;
+
+    private:
+        static constexpr uint32_t empty = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t m_hash;
+            uint32_t m_entry;
+        };
+
+        // the size is zero or a power of two
+        std::vector<Slot> m_slots;
+
+        size_t probe_distance(size_t pos) const
+        {
+            return (pos - m_slots[pos].m_hash) & (m_slots.size() - 1);
+        }
+
+        size_t find_slot(const Value &key, uint32_t hash) const;
+        void place(Slot slot);
+        void rebuild(size_t slot_count);
+    };
+
+    struct DictIter : NativeType
+    {
+        static const Method methods[2];
+
+        Dict *m_dict = nullptr;
+        size_t m_pos = 0;
+
+        DictIter()
+            : NativeType(ObjectType::DictIter, methods)
+        {
+        }
+
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
+
+        std::string get_name() const override
+        {
+            return "DictIter";
         }
 
-        Object *put(Object *my, const std::vector<Object *> &args);
-        Object *pop(Object *my);
-        Object *pop_at(Object *my, const std::vector<Object *> &args);
-        Object *pop_all(Object *my, const std::vector<Object *> &args);
-        Object *len(Object *my);
-        Object *clear(Object *my);
+        void trace() override;
+    };
+
+    struct Dict : NativeType, Indexable
+    {
+        static const Method methods[8];
+
+        HashTable m_table;
+
+        Dict()
+            : NativeType(ObjectType::Dict, methods)
+        {
+        }
+
+        Value get(Value key) override;
+        void set(Value key, Value val) override;
+
+        std::string to_str() const override;
+        bool equals(Object *other) const override;
 
-        void mark() override;
+        std::string get_name() const override
+        {
+            return "Dict";
+        }
+
+        uint32_t key_hash(const Value &key) const;
+
+        static Value iter(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+        static Value has(Object *my, const std::vector<Value> &args);
+        static Value get_or(Object *my, const std::vector<Value> &args);
+        static Value remove(Object *my, const std::vector<Value> &args);
+        static Value keys(Object *my, const std::vector<Value> &args);
+        static Value values(Object *my, const std::vector<Value> &args);
+        static Value clear(Object *my, const std::vector<Value> &args);
+
+        void trace() override;
     };
 
-    struct Null : Object
+    struct SetIter : NativeType
     {
-        Null()
-            : Object(nullptr)
+        static const Method methods[2];
+
+        Set *m_set = nullptr;
+        size_t m_pos = 0;
+
+        SetIter()
+            : NativeType(ObjectType::SetIter, methods)
         {
         }
 
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
+
+        std::string get_name() const override
+        {
+            return "SetIter";
+        }
+
+        void trace() override;
+    };
+
+    // the values of the table are unused; s[x] tells whether x is in the set,
+    // let s[x] = true adds x to it and let s[x] = false removes it
+    struct Set : NativeType, Indexable
+    {
+        static const Method methods[6];
+
+        HashTable m_table;
+
+        Set()
+            : NativeType(ObjectType::Set, methods)
+        {
+        }
+
+        Value get(Value key) override;
+        void set(Value key, Value val) override;
+
         std::string to_str() const override;
+        bool equals(Object *other) const override;
 
-        bool equals(Object *other) const override
+        std::string get_name() const override
         {
-            Null *p = dynamic_cast<Null *>(other);
+            return "Set";
+        }
+
+        uint32_t key_hash(const Value &key) const;
+        void add(const Value &key);
+
+        static Value iter(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+        static Value has(Object *my, const std::vector<Value> &args);
+        static Value put(Object *my, const std::vector<Value> &args);
+        static Value remove(Object *my, const std::vector<Value> &args);
+        static Value clear(Object *my, const std::vector<Value> &args);
+
+        void trace() override;
+    };
 
-            if (p)
+    // a list of ints or floats stored unboxed and contiguously, whose numeric methods
+    // run the kernels of simd.hpp; scale() and add() change the array in place
+    template <typename T>
+    struct Array : NativeType, Indexable
+    {
+        static constexpr ObjectType tag = std::is_same_v<T, long long> ? ObjectType::IntArray : ObjectType::FloatArray;
+
+        static const Method methods[10];
+
+        std::vector<T> m_vals;
+
+        Array()
+            : NativeType(tag, methods)
+        {
+        }
+
+        // an array of init zeros or of the elements of the list init
+        static Value create(const Value &init);
+
+        static const char *type_name()
+        {
+            return tag == ObjectType::IntArray ? "IntArray" : "FloatArray";
+        }
+
+        // a float array takes ints as well
+        static bool from_value(const Value &v, T &res);
+
+        static Value to_value(T v)
+        {
+            if constexpr (tag == ObjectType::IntArray)
+            {
+                return Value::integer(v);
+            }
+            else
             {
-                return true;
+                return Value::floating(v);
             }
+        }
 
-            return false;
+        Value get(Value index) override;
+        void set(Value index, Value val) override;
+
+        std::string to_str() const override;
+
+        bool equals(Object *other) const override
+        {
+            return other->m_tag == tag && m_vals == static_cast<Array *>(other)->m_vals;
+        }
+
+        std::string get_name() const override
+        {
+            return type_name();
         }
 
-        void mark() override;
+        static Value iter(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+        static Value put(Object *my, const std::vector<Value> &args);
+        static Value sum(Object *my, const std::vector<Value> &args);
+        static Value min(Object *my, const std::vector<Value> &args);
+        static Value max(Object *my, const std::vector<Value> &args);
+        static Value dot(Object *my, const std::vector<Value> &args);
+        static Value scale(Object *my, const std::vector<Value> &args);
+        static Value add(Object *my, const std::vector<Value> &args);
+        static Value to_list(Object *my, const std::vector<Value> &args);
     };
+
+    using IntArray = Array<long long>;
+    using FloatArray = Array<double>;
+
+    struct ArrayIter : NativeType
+    {
+        static const Method methods[2];
+
+        // an IntArray or a FloatArray
+        Object *m_array = nullptr;
+        size_t m_pos = 0;
+
+        ArrayIter()
+            : NativeType(ObjectType::ArrayIter, methods)
+        {
+        }
+
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
+
+        std::string get_name() const override
+        {
+            return "ArrayIter";
+        }
+
+        void trace() override;
+    };
+
+    // the integers from m_begin up to m_end, not including it, by m_step, which are computed as they are iterated
+    struct Range : NativeType, Indexable
+    {
+        static const Method methods[2];
+
+        long long m_begin = 0;
+        long long m_end = 0;
+        long long m_step = 1;
+
+        Range()
+            : NativeType(ObjectType::Range, methods)
+        {
+        }
+
+        // the range of the ints begin, end and step, reporting the errors of a range loop
+        static Value create(const Value &begin, const Value &end, const Value &step);
+
+        // the number of the integers of a range, counted in unsigned arithmetic, which cannot overflow
+        static unsigned long long length(long long begin, long long end, long long step);
+
+        unsigned long long size() const
+        {
+            return length(m_begin, m_end, m_step);
+        }
+
+        Value get(Value index) override;
+        void set(Value, Value) override;
+
+        std::string to_str() const override;
+
+        bool equals(Object *other) const override;
+
+        std::string get_name() const override
+        {
+            return "Range";
+        }
+
+        static Value iter(Object *my, const std::vector<Value> &args);
+        static Value len(Object *my, const std::vector<Value> &args);
+    };
+
+    struct RangeIter : NativeType
+    {
+        static const Method methods[2];
+
+        long long m_next = 0;
+        long long m_step = 1;
+        unsigned long long m_left = 0;
+
+        RangeIter()
+            : NativeType(ObjectType::RangeIter, methods)
+        {
+        }
+
+        static Value has_next(Object *my, const std::vector<Value> &args);
+        static Value next(Object *my, const std::vector<Value> &args);
+
+        std::string get_name() const override
+        {
+            return "RangeIter";
+        }
+    };
+
+    inline Indexable *as_indexable(const Value &v)
+    {
+        switch (v.m_tag)
+        {
+        case ObjectType::String:
+            return static_cast<String *>(v.m_obj);
+        case ObjectType::List:
+            return static_cast<List *>(v.m_obj);
+        case ObjectType::Dict:
+            return static_cast<Dict *>(v.m_obj);
+        case ObjectType::Set:
+            return static_cast<Set *>(v.m_obj);
+        case ObjectType::IntArray:
+            return static_cast<IntArray *>(v.m_obj);
+        case ObjectType::FloatArray:
+            return static_cast<FloatArray *>(v.m_obj);
+        case ObjectType::Range:
+            return static_cast<Range *>(v.m_obj);
+        default:
+            return nullptr;
+        }
+    }
 }
\ No newline at end of file
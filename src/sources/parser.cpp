@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "parser.hpp"
+#include "resolver.hpp"
 
 using namespace std;
 using namespace halo;
@@ -73,9 +74,26 @@ Expr *Parser::alloc_list(const std::vector<Expr *> &params, size_t line)
     return m_nodes.back().get();
 }
 
+Expr *Parser::alloc_dict(const std::vector<Expr *> &keys, const std::vector<Expr *> &vals, size_t line)
+{
+    m_nodes.push_back(make_unique<DictExpr>(keys, vals, line));
+    return m_nodes.back().get();
+}
+
+Expr *Parser::alloc_set(const std::vector<Expr *> &params, size_t line)
+{
+    m_nodes.push_back(make_unique<SetExpr>(params, line));
+    return m_nodes.back().get();
+}
+
 Expr *Parser::parse_expr()
 {
-    return expr();
+    Expr *e = expr();
+
+    Resolver resolver;
+    resolver.resolve(e);
+
+    return e;
 }
 
 void Parser::parse()
@@ -92,6 +110,9 @@ void Parser::parse()
         m_had_errors = true;
         throw;
     }
+
+    Resolver resolver;
+    resolver.resolve(m_stmts);
 }
 
 Stmt *Parser::statement(size_t line)
@@ -401,7 +422,7 @@ Stmt *Parser::fun_statement(size_t line)
         params.push_back(consume(TokenType::Identifier, "Parse error\n    line " + to_string(peek().m_line) + ": <fun statement> expected parameter name after ',' symbol in function '" + name.m_lexeme + "'"));
 
         if (count_if(begin(params), end(params), [&params](const auto &p)
-                     { return p.m_lexeme == params.back().m_lexeme; }) > 1)
+                     { return p.symbol() == params.back().symbol(); }) > 1)
         {
             throw runtime_error("Parse error\n    line " + to_string(peek().m_line) + ": <fun statement> duplicate parameter '" + params.back().m_lexeme + "' in function '" + name.m_lexeme + "'");
         }
@@ -692,6 +713,10 @@ Expr *Parser::primary()
     {
         return list();
     }
+    else if (match(TokenType::OpenBrace))
+    {
+        return dict_or_set();
+    }
 
     throw runtime_error("Parse error\n    line " + to_string(peek().m_line) + ": <primary expression> unknown expression");
 }
@@ -721,7 +746,7 @@ Expr *Parser::lambda()
             capture.push_back(consume(TokenType::Identifier, "Parse error\n    line " + to_string(peek().m_line) + ": <lambda expression> expected capture element name after ',' symbol"));
 
             if (count_if(begin(capture), end(capture), [&capture](const auto &e)
-                         { return e.m_lexeme == capture.back().m_lexeme; }) > 1)
+                         { return e.symbol() == capture.back().symbol(); }) > 1)
             {
                 throw runtime_error("Parse error\n    line " + to_string(peek().m_line) + ": <lambda expression> duplicate capture element '" + capture.back().m_lexeme + "'");
             }
@@ -742,7 +767,7 @@ Expr *Parser::lambda()
         params.push_back(consume(TokenType::Identifier, "Parse error\n    line " + to_string(peek().m_line) + ": <lambda expression> expected parameter name after ',' symbol"));
 
         if (count_if(begin(params), end(params), [&params](const auto &p)
-                     { return p.m_lexeme == params.back().m_lexeme; }) > 1)
+                     { return p.symbol() == params.back().symbol(); }) > 1)
         {
             throw runtime_error("Parse error\n    line " + to_string(peek().m_line) + ": <lambda expression> duplicate parameter '" + params.back().m_lexeme + "'");
         }
@@ -792,6 +817,47 @@ Expr *Parser::list()
     return alloc_list(args, line);
 }
 
+// {} and {key: val, ...} are dicts, {el, ...} is a set
+Expr *Parser::dict_or_set()
+{
+    size_t line = m_tokens[m_curr - 1].m_line;
+
+    vector<Expr *> keys;
+    vector<Expr *> vals;
+
+    if (match(TokenType::CloseBrace))
+    {
+        return alloc_dict(keys, vals, line);
+    }
+
+    keys.push_back(expr());
+
+    if (!match(TokenType::Colon))
+    {
+        while (match(TokenType::Comma))
+        {
+            keys.push_back(expr());
+        }
+
+        consume(TokenType::CloseBrace, "Parse error\n    line " + to_string(peek().m_line) + ": <set expression> expected '}' symbol");
+
+        return alloc_set(keys, line);
+    }
+
+    vals.push_back(expr());
+
+    while (match(TokenType::Comma))
+    {
+        keys.push_back(expr());
+        consume(TokenType::Colon, "Parse error\n    line " + to_string(peek().m_line) + ": <dict expression> expected ':' symbol");
+        vals.push_back(expr());
+    }
+
+    consume(TokenType::CloseBrace, "Parse error\n    line " + to_string(peek().m_line) + ": <dict expression> expected '}' symbol");
+
+    return alloc_dict(keys, vals, line);
+}
+
 /*
     HELPING FUNCTIONS
 */
@@ -55,6 +55,7 @@ namespace halo
         Expr *primary();
         Expr *lambda();
         Expr *list();
+        Expr *dict_or_set();
 
         // Expr *alloc_grouping(Expr *e);
         Expr *alloc_binary_expr(Token t, Expr *l, Expr *r);
@@ -67,6 +68,8 @@ namespace halo
         Expr *alloc_var(Token t);
         Expr *alloc_lambda(const std::vector<Token> &capture, const std::vector<Token> &params, std::vector<std::unique_ptr<Stmt>> body, size_t line);
         Expr *alloc_list(const std::vector<Expr *> &params, size_t line);
+        Expr *alloc_dict(const std::vector<Expr *> &keys, const std::vector<Expr *> &vals, size_t line);
+        Expr *alloc_set(const std::vector<Expr *> &params, size_t line);
 
         bool match(TokenType t);
         const Token &consume(TokenType t, std::string err);
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace halo
+{
+    // allocates objects of one type from pages of fixed-size slots;
+    // free slots are chained through their headers, so allocation and
+    // deallocation take no malloc/free, and a sweep walks the pages in order
+    template <typename T>
+    class Pool
+    {
+        struct Slot
+        {
+            Slot *m_next_free;
+            bool m_used;
+            alignas(T) unsigned char m_mem[sizeof(T)];
+        };
+
+        static constexpr size_t page_size = 256;
+
+        std::vector<std::unique_ptr<Slot[]>> m_pages;
+        Slot *m_free = nullptr;
+        size_t m_count = 0;
+
+        static T *object(Slot &s)
+        {
+            return std::launder(reinterpret_cast<T *>(s.m_mem));
+        }
+
+        static Slot *slot(T *o)
+        {
+            return reinterpret_cast<Slot *>(reinterpret_cast<unsigned char *>(o) - offsetof(Slot, m_mem));
+        }
+
+        void add_page()
+        {
+            m_pages.emplace_back(new Slot[page_size]);
+            Slot *page = m_pages.back().get();
+
+            for (size_t i = page_size; i > 0; --i)
+            {
+                page[i - 1].m_used = false;
+                page[i - 1].m_next_free = m_free;
+                m_free = &page[i - 1];
+            }
+        }
+
+    public:
+        Pool() = default;
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+
+        ~Pool()
+        {
+            for_each([this](T *o)
+                     { destroy(o); });
+        }
+
+        T *create()
+        {
+            if (!m_free)
+            {
+                add_page();
+            }
+
+            Slot *s = m_free;
+            m_free = s->m_next_free;
+            s->m_used = true;
+            ++m_count;
+
+            return new (s->m_mem) T();
+        }
+
+        void destroy(T *o)
+        {
+            Slot *s = slot(o);
+            o->~T();
+            s->m_used = false;
+            s->m_next_free = m_free;
+            m_free = s;
+            --m_count;
+        }
+
+        // calls f for every allocated object; f may destroy the object it is given
+        template <typename F>
+        void for_each(F f)
+        {
+            for (auto &page : m_pages)
+            {
+                for (size_t i = 0; i < page_size; ++i)
+                {
+                    if (page[i].m_used)
+                    {
+                        f(object(page[i]));
+                    }
+                }
+            }
+        }
+
+        // the slots freed by sweep_pages(), not yet returned to the pool
+        struct FreeChain
+        {
+            Slot *m_head = nullptr;
+            Slot *m_tail = nullptr;
+            size_t m_count = 0;
+        };
+
+        // destroys every allocated object of the pages [begin, end) for which keep returns false;
+        // calls for disjoint ranges may run in parallel, the pool itself is updated by add_free()
+        template <typename F>
+        FreeChain sweep_pages(size_t begin, size_t end, F keep)
+        {
+            FreeChain chain;
+
+            for (size_t p = begin; p < end; ++p)
+            {
+                Slot *slots = m_pages[p].get();
+
+                for (size_t i = 0; i < page_size; ++i)
+                {
+                    if (slots[i].m_used && !keep(object(slots[i])))
+                    {
+                        object(slots[i])->~T();
+                        slots[i].m_used = false;
+                        slots[i].m_next_free = chain.m_head;
+                        chain.m_head = &slots[i];
+                        chain.m_tail = chain.m_tail ? chain.m_tail : &slots[i];
+                        ++chain.m_count;
+                    }
+                }
+            }
+
+            return chain;
+        }
+
+        void add_free(const FreeChain &chain)
+        {
+            if (chain.m_count == 0)
+            {
+                return;
+            }
+
+            chain.m_tail->m_next_free = m_free;
+            m_free = chain.m_head;
+            m_count -= chain.m_count;
+        }
+
+        size_t page_count() const
+        {
+            return m_pages.size();
+        }
+
+        static constexpr size_t slots_per_page()
+        {
+            return page_size;
+        }
+
+        size_t count() const
+        {
+            return m_count;
+        }
+    };
+}
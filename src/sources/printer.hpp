@@ -8,7 +8,7 @@ namespace halo
     {
         std::ostringstream m_data;
 
-        Object *visit_grouping(Grouping *e) override
+        Value visit_grouping(Grouping *e) override
         {
             m_data << "(";
             e->expr->visit(this);
@@ -17,7 +17,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_binary_expr(BinaryExpr *e) override
+        Value visit_binary_expr(BinaryExpr *e) override
         {
             m_data << "(";
             e->m_left->visit(this);
@@ -28,7 +28,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_logical_expr(LogicalExpr *e) override
+        Value visit_logical_expr(LogicalExpr *e) override
         {
             m_data << "(";
             e->m_left->visit(this);
@@ -39,7 +39,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_unary_expr(UnaryExpr *e) override
+        Value visit_unary_expr(UnaryExpr *e) override
         {
             m_data << "(";
             m_data << e->m_token.m_lexeme;
@@ -49,7 +49,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_call_expr(Call *e) override
+        Value visit_call_expr(Call *e) override
         {
             e->m_expr->visit(this);
             m_data << "(";
@@ -66,7 +66,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_dot_expr(Dot *e) override
+        Value visit_dot_expr(Dot *e) override
         {
             e->m_expr->visit(this);
             m_data << "." << e->m_name.m_lexeme;
@@ -74,7 +74,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_subscript_expr(Subscript *e) override
+        Value visit_subscript_expr(Subscript *e) override
         {
             e->m_expr->visit(this);
             m_data << "[";
@@ -84,21 +84,21 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_literal(Literal *e) override
+        Value visit_literal(Literal *e) override
         {
             m_data << e->m_token.m_lexeme;
 
             return nullptr;
         }
 
-        Object *visit_var(Var *e) override
+        Value visit_var(Var *e) override
         {
             m_data << e->m_token.m_lexeme;
 
             return nullptr;
         }
 
-        Object *visit_lambda(Lambda *e) override
+        Value visit_lambda(Lambda *e) override
         {
             m_data << "lambda[" << e->m_capture.size() << "]"
                    << "(" << e->m_params.size() << ")";
@@ -106,7 +106,7 @@ namespace halo
             return nullptr;
         }
 
-        Object *visit_list(ListExpr *e) override
+        Value visit_list(ListExpr *e) override
         {
             m_data << "[";
             for (size_t i = 0; i < e->m_params.size(); ++i)
@@ -121,5 +121,39 @@ namespace halo
 
             return nullptr;
         }
+
+        Value visit_dict(DictExpr *e) override
+        {
+            m_data << "{";
+            for (size_t i = 0; i < e->m_keys.size(); ++i)
+            {
+                if (i != 0)
+                {
+                    m_data << ", ";
+                }
+                e->m_keys[i]->visit(this);
+                m_data << ": ";
+                e->m_vals[i]->visit(this);
+            }
+            m_data << "}";
+
+            return nullptr;
+        }
+
+        Value visit_set(SetExpr *e) override
+        {
+            m_data << "{";
+            for (size_t i = 0; i < e->m_params.size(); ++i)
+            {
+                if (i != 0)
+                {
+                    m_data << ", ";
+                }
+                e->m_params[i]->visit(this);
+            }
+            m_data << "}";
+
+            return nullptr;
+        }
     };
 }
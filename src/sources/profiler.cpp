@@ -0,0 +1,162 @@
+#include "profiler.hpp"
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+
+using namespace std;
+using namespace halo;
+
+Profiler::Profiler(long interval_us)
+    : m_interval_us(interval_us)
+{
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::on_timer(int)
+{
+    s_pending = 1;
+}
+
+void Profiler::start()
+{
+    struct sigaction sa = {};
+    sa.sa_handler = on_timer;
+    // reads of the script input must not fail with EINTR
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(SIGPROF, &sa, nullptr) != 0)
+    {
+        throw runtime_error("cannot install the profiler signal handler");
+    }
+
+    itimerval timer = {};
+    timer.it_interval.tv_sec = m_interval_us / 1000000;
+    timer.it_interval.tv_usec = m_interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+    {
+        throw runtime_error("cannot start the profiler timer");
+    }
+
+    m_running = true;
+}
+
+void Profiler::stop()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    clear_pending();
+    m_running = false;
+}
+
+void Profiler::add_sample(vector<Frame> stack)
+{
+    ++m_stacks[move(stack)];
+    ++m_samples;
+}
+
+void Profiler::report_folded(ostream &out) const
+{
+    for (const auto &[stack, count] : m_stacks)
+    {
+        for (size_t i = 0; i < stack.size(); ++i)
+        {
+            // ';' separates the frames
+            string name = stack[i].m_name;
+            replace(name.begin(), name.end(), ';', ',');
+
+            out << (i ? ";" : "") << name << ':' << stack[i].m_line;
+        }
+
+        out << ' ' << count << '\n';
+    }
+}
+
+void Profiler::report_top(ostream &out, size_t top) const
+{
+    // self and total samples, a function or a line counts once per sample even if it recurses
+    map<string, pair<size_t, size_t>> functions;
+    map<string, pair<size_t, size_t>> lines;
+
+    for (const auto &[stack, count] : m_stacks)
+    {
+        set<string> seen_functions;
+        set<string> seen_lines;
+
+        for (size_t i = 0; i < stack.size(); ++i)
+        {
+            const Frame &frame = stack[i];
+            string line = frame.m_name + ":" + to_string(frame.m_line);
+            bool leaf = i + 1 == stack.size();
+
+            if (seen_functions.insert(frame.m_name).second)
+            {
+                functions[frame.m_name].second += count;
+            }
+            if (seen_lines.insert(line).second)
+            {
+                lines[line].second += count;
+            }
+            if (leaf)
+            {
+                functions[frame.m_name].first += count;
+                lines[line].first += count;
+            }
+        }
+    }
+
+    out << "Profile: " << m_samples << " samples, one every " << m_interval_us << " us of CPU time\n";
+    report_table(out, functions, "function", top);
+    report_table(out, lines, "line", top);
+}
+
+void Profiler::report_table(ostream &out, const map<string, pair<size_t, size_t>> &rows, const string &title, size_t top) const
+{
+    vector<pair<string, pair<size_t, size_t>>> sorted(rows.begin(), rows.end());
+    sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+         { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+
+    if (sorted.size() > top)
+    {
+        sorted.resize(top);
+    }
+
+    auto ms = [this](size_t samples)
+    {
+        return double(samples) * m_interval_us / 1000;
+    };
+
+    auto percent = [this](size_t samples)
+    {
+        return m_samples ? 100.0 * samples / m_samples : 0;
+    };
+
+    out << '\n'
+        << setw(10) << "self ms" << setw(8) << "self %" << setw(10) << "total ms" << setw(9) << "total %"
+        << "  " << title << '\n'
+        << fixed << setprecision(1);
+
+    for (const auto &[name, samples] : sorted)
+    {
+        out << setw(10) << ms(samples.first) << setw(8) << percent(samples.first)
+            << setw(10) << ms(samples.second) << setw(9) << percent(samples.second) << "  " << name << '\n';
+    }
+
+    out << defaultfloat;
+}
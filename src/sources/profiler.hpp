@@ -0,0 +1,77 @@
+#pragma once
+
+#include <csignal>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace halo
+{
+    // a sampling profiler of Halo scripts: a SIGPROF timer only raises a flag, and the interpreter
+    // and the VM record their call stack the next time they enter an expression or an instruction,
+    // so a sample is never taken while the stack is half made
+    //
+    // at exit the samples are written as folded stacks, one line per distinct stack,
+    // which flame graph tools read, and as tables of the functions and lines that took the most time
+    class Profiler
+    {
+    public:
+        // a function on the sampled stack and the line it was executing
+        struct Frame
+        {
+            std::string m_name;
+            size_t m_line;
+
+            bool operator<(const Frame &other) const
+            {
+                return m_line != other.m_line ? m_line < other.m_line : m_name < other.m_name;
+            }
+        };
+
+    private:
+        static inline volatile std::sig_atomic_t s_pending = 0;
+
+        static void on_timer(int);
+
+        long m_interval_us;
+        bool m_running = false;
+        size_t m_samples = 0;
+        // the stacks from the script down to the innermost call, and how many samples saw each
+        std::map<std::vector<Frame>, size_t> m_stacks;
+
+        void report_table(std::ostream &out, const std::map<std::string, std::pair<size_t, size_t>> &rows,
+                          const std::string &title, size_t top) const;
+
+    public:
+        explicit Profiler(long interval_us = 1000);
+        ~Profiler();
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        static bool pending()
+        {
+            return s_pending;
+        }
+
+        static void clear_pending()
+        {
+            s_pending = 0;
+        }
+
+        void start();
+        void stop();
+
+        void add_sample(std::vector<Frame> stack);
+
+        size_t samples() const
+        {
+            return m_samples;
+        }
+
+        void report_folded(std::ostream &out) const;
+        // the self and total time of the top functions and lines
+        void report_top(std::ostream &out, size_t top = 20) const;
+    };
+}
@@ -0,0 +1,390 @@
+#include "resolver.hpp"
+
+using namespace std;
+using namespace halo;
+
+namespace
+{
+    // a block that declares no variables needs no scope, it gets the size 0 and
+    // the interpreter and the compiler skip entering it, which saves a scope per iteration of a loop
+    bool declares_variables(const std::vector<std::unique_ptr<Stmt>> &stmts)
+    {
+        for (auto &stmt : stmts)
+        {
+            if (dynamic_cast<VarStmt *>(stmt.get()))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+Resolver::Resolver()
+    : m_fun_begin(0)
+{
+}
+
+void Resolver::resolve(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    resolve_block(stmts);
+}
+
+void Resolver::resolve(Expr *e)
+{
+    e->visit(this);
+}
+
+void Resolver::begin_scope()
+{
+    m_scopes.emplace_back();
+}
+
+size_t Resolver::end_scope()
+{
+    size_t size = m_scopes.back().m_names.size();
+    m_scopes.pop_back();
+    return size;
+}
+
+Location Resolver::declare(const Token &t)
+{
+    Location loc;
+
+    if (m_scopes.empty())
+    {
+        return loc;
+    }
+
+    // a second declaration gets the same slot, so the environment reports it as defined already
+    auto &names = m_scopes.back().m_names;
+    auto it = names.emplace(t.symbol(), names.size()).first;
+
+    loc.m_depth = 0;
+    loc.m_slot = it->second;
+    return loc;
+}
+
+Location Resolver::resolve_name(const Token &t)
+{
+    Location loc;
+
+    for (size_t i = m_scopes.size(); i > m_fun_begin; --i)
+    {
+        auto &names = m_scopes[i - 1].m_names;
+        auto it = names.find(t.symbol());
+
+        if (it != names.end())
+        {
+            loc.m_depth = m_scopes.size() - i;
+            loc.m_slot = it->second;
+            return loc;
+        }
+    }
+
+    return loc;
+}
+
+void Resolver::resolve_block(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    for (auto &stmt : stmts)
+    {
+        stmt->visit(this);
+    }
+}
+
+size_t Resolver::resolve_scoped_block(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    if (!declares_variables(stmts))
+    {
+        resolve_block(stmts);
+        return 0;
+    }
+
+    begin_scope();
+    resolve_block(stmts);
+    return end_scope();
+}
+
+void Resolver::resolve_function(FunStmt *fst, bool is_method)
+{
+    size_t enclosing_fun_begin = m_fun_begin;
+    m_fun_begin = m_scopes.size();
+
+    begin_scope();
+
+    if (is_method)
+    {
+        declare(Token(TokenType::Var, "my", 0, 0));
+    }
+
+    fst->m_param_slots.clear();
+
+    for (auto &p : fst->m_params)
+    {
+        fst->m_param_slots.push_back(declare(p).m_slot);
+    }
+
+    resolve_block(fst->m_body);
+
+    fst->m_scope_size = end_scope();
+    m_fun_begin = enclosing_fun_begin;
+}
+
+/*
+    EXPRESSIONS
+*/
+
+Value Resolver::visit_grouping(Grouping *e)
+{
+    e->expr->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_binary_expr(BinaryExpr *e)
+{
+    e->m_left->visit(this);
+    e->m_right->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_logical_expr(LogicalExpr *e)
+{
+    e->m_left->visit(this);
+    e->m_right->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_unary_expr(UnaryExpr *e)
+{
+    e->m_expr->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_call_expr(Call *e)
+{
+    e->m_expr->visit(this);
+
+    for (auto arg : e->m_args)
+    {
+        arg->visit(this);
+    }
+
+    return nullptr;
+}
+
+Value Resolver::visit_dot_expr(Dot *e)
+{
+    e->m_expr->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_subscript_expr(Subscript *e)
+{
+    e->m_expr->visit(this);
+    e->m_index->visit(this);
+    return nullptr;
+}
+
+Value Resolver::visit_literal([[maybe_unused]] Literal *e)
+{
+    return nullptr;
+}
+
+Value Resolver::visit_var(Var *e)
+{
+    e->m_loc = resolve_name(e->m_token);
+    return nullptr;
+}
+
+Value Resolver::visit_lambda(Lambda *e)
+{
+    e->m_capture_locs.clear();
+
+    for (auto &t : e->m_capture)
+    {
+        e->m_capture_locs.push_back(resolve_name(t));
+    }
+
+    size_t enclosing_fun_begin = m_fun_begin;
+    m_fun_begin = m_scopes.size();
+
+    begin_scope();
+
+    e->m_param_slots.clear();
+
+    for (auto &p : e->m_params)
+    {
+        e->m_param_slots.push_back(declare(p).m_slot);
+    }
+
+    // the body runs right in the capture scope
+    begin_scope();
+
+    e->m_capture_slots.clear();
+
+    for (auto &t : e->m_capture)
+    {
+        e->m_capture_slots.push_back(declare(t).m_slot);
+    }
+
+    resolve_block(e->m_body);
+
+    e->m_capture_size = end_scope();
+    e->m_params_size = end_scope();
+
+    m_fun_begin = enclosing_fun_begin;
+
+    return nullptr;
+}
+
+Value Resolver::visit_list(ListExpr *e)
+{
+    for (auto el : e->m_params)
+    {
+        el->visit(this);
+    }
+
+    return nullptr;
+}
+
+Value Resolver::visit_dict(DictExpr *e)
+{
+    for (size_t i = 0; i < e->m_keys.size(); ++i)
+    {
+        e->m_keys[i]->visit(this);
+        e->m_vals[i]->visit(this);
+    }
+
+    return nullptr;
+}
+
+Value Resolver::visit_set(SetExpr *e)
+{
+    for (auto el : e->m_params)
+    {
+        el->visit(this);
+    }
+
+    return nullptr;
+}
+
+/*
+    STATEMENTS
+*/
+
+void Resolver::visit_var_stmt(VarStmt *e)
+{
+    if (e->m_expr)
+    {
+        e->m_expr->visit(this);
+    }
+
+    e->m_loc = declare(e->m_token);
+}
+
+void Resolver::visit_assignment_stmt(AssignmentStmt *e)
+{
+    e->m_lval->visit(this);
+    e->m_expr->visit(this);
+}
+
+void Resolver::visit_expression_stmt(ExpressionStmt *e)
+{
+    e->m_expr->visit(this);
+}
+
+void Resolver::visit_if_stmt(IfStmt *e)
+{
+    e->m_then_sizes.clear();
+
+    for (size_t i = 0; i < e->m_conds.size(); ++i)
+    {
+        e->m_conds[i]->visit(this);
+
+        e->m_then_sizes.push_back(resolve_scoped_block(e->m_then_branches[i]));
+    }
+
+    e->m_else_size = resolve_scoped_block(e->m_else_branch);
+}
+
+void Resolver::visit_while_stmt(WhileStmt *e)
+{
+    e->m_cond->visit(this);
+
+    e->m_do_size = resolve_scoped_block(e->m_do_branch);
+}
+
+void Resolver::visit_for_stmt(ForStmt *e)
+{
+    // the range or the iterable is evaluated before the header scope is entered
+    if (e->m_begin)
+    {
+        e->m_begin->visit(this);
+        e->m_end->visit(this);
+
+        if (e->m_step)
+        {
+            e->m_step->visit(this);
+        }
+    }
+    else
+    {
+        e->m_iterable->visit(this);
+    }
+
+    bool body_scope = declares_variables(e->m_do_branch);
+    bool header_scope = e->m_iterable || !body_scope;
+
+    if (header_scope)
+    {
+        begin_scope();
+    }
+
+    if (e->m_iterable)
+    {
+        declare(Token(TokenType::Var, "__for_iterable__", 0, 0));
+        declare(Token(TokenType::Var, "__for_it__", 0, 0));
+    }
+
+    if (body_scope)
+    {
+        begin_scope();
+    }
+
+    e->m_loc = declare(e->m_identifier);
+    resolve_block(e->m_do_branch);
+
+    e->m_do_size = body_scope ? end_scope() : 0;
+    e->m_header_size = header_scope ? end_scope() : 0;
+}
+
+void Resolver::visit_break_stmt([[maybe_unused]] BreakStmt *e)
+{
+}
+
+void Resolver::visit_continue_stmt([[maybe_unused]] ContinueStmt *e)
+{
+}
+
+void Resolver::visit_fun_stmt(FunStmt *e)
+{
+    resolve_function(e, false);
+}
+
+void Resolver::visit_return_stmt(ReturnStmt *e)
+{
+    if (e->m_expr)
+    {
+        e->m_expr->visit(this);
+    }
+}
+
+void Resolver::visit_class_stmt(ClassStmt *e)
+{
+    for (auto &f : e->m_methods)
+    {
+        resolve_function(f.get(), true);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "expr.hpp"
+#include "stmt.hpp"
+
+namespace halo
+{
+    // assigns every local variable a slot in its scope, so that the environment
+    // can find it by index instead of looking its name up scope by scope
+    class Resolver : public ExprVisitor, public StmtVisitor
+    {
+        struct Scope
+        {
+            std::unordered_map<Symbol, size_t> m_names;
+        };
+
+        std::vector<Scope> m_scopes;
+
+        // scopes below this one belong to enclosing functions and are not visible
+        size_t m_fun_begin;
+
+        void begin_scope();
+        size_t end_scope();
+
+        Location declare(const Token &t);
+        Location resolve_name(const Token &t);
+
+        void resolve_block(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        size_t resolve_scoped_block(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        void resolve_function(FunStmt *fst, bool is_method);
+
+    public:
+        Resolver();
+
+        void resolve(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        void resolve(Expr *e);
+
+        Value visit_grouping(Grouping *e) override;
+        Value visit_binary_expr(BinaryExpr *e) override;
+        Value visit_logical_expr(LogicalExpr *e) override;
+        Value visit_unary_expr(UnaryExpr *e) override;
+        Value visit_call_expr(Call *e) override;
+        Value visit_dot_expr(Dot *e) override;
+        Value visit_subscript_expr(Subscript *e) override;
+        Value visit_literal(Literal *e) override;
+        Value visit_var(Var *e) override;
+        Value visit_lambda(Lambda *e) override;
+        Value visit_list(ListExpr *e) override;
+        Value visit_dict(DictExpr *e) override;
+        Value visit_set(SetExpr *e) override;
+
+        void visit_var_stmt(VarStmt *e) override;
+        void visit_assignment_stmt(AssignmentStmt *e) override;
+        void visit_expression_stmt(ExpressionStmt *e) override;
+        void visit_if_stmt(IfStmt *e) override;
+        void visit_while_stmt(WhileStmt *e) override;
+        void visit_for_stmt(ForStmt *e) override;
+        void visit_break_stmt(BreakStmt *e) override;
+        void visit_continue_stmt(ContinueStmt *e) override;
+        void visit_fun_stmt(FunStmt *e) override;
+        void visit_return_stmt(ReturnStmt *e) override;
+        void visit_class_stmt(ClassStmt *e) override;
+    };
+}
\ No newline at end of file
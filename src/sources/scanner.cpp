@@ -51,6 +51,12 @@ std::vector<Token> Scanner::scan()
         case ']':
             read_one_symbol_lexeme(TokenType::CloseBracket);
             break;
+        case '{':
+            read_one_symbol_lexeme(TokenType::OpenBrace);
+            break;
+        case '}':
+            read_one_symbol_lexeme(TokenType::CloseBrace);
+            break;
         case '+':
             read_two_symbol_lexeme(TokenType::Plus, TokenType::PlusEqual);
             break;
@@ -256,33 +262,33 @@ void Scanner::read_number()
 
 namespace
 {
-    unordered_map<string, TokenType> keywords = {
-        {"not", TokenType::Not},
-        {"and", TokenType::And},
-        {"or", TokenType::Or},
-        {"var", TokenType::Var},
-        {"let", TokenType::Let},
-        {"true", TokenType::True},
-        {"false", TokenType::False},
-        {"null", TokenType::Null},
-        {"if", TokenType::If},
-        {"elif", TokenType::Elif},
-        {"else", TokenType::Else},
-        {"for", TokenType::For},
-        {"in", TokenType::In},
-        {"while", TokenType::While},
-        {"end", TokenType::End},
-        {"break", TokenType::Break},
-        {"continue", TokenType::Continue},
-        {"throw", TokenType::Throw},
-        {"try", TokenType::Try},
-        {"catch", TokenType::Catch},
-        {"finally", TokenType::Finally},
-        {"fun", TokenType::Fun},
-        {"return", TokenType::Return},
-        {"class", TokenType::Class},
-        {"lambda", TokenType::Lambda},
-        {"import", TokenType::Import},
+    unordered_map<Symbol, TokenType> keywords = {
+        {intern("not"), TokenType::Not},
+        {intern("and"), TokenType::And},
+        {intern("or"), TokenType::Or},
+        {intern("var"), TokenType::Var},
+        {intern("let"), TokenType::Let},
+        {intern("true"), TokenType::True},
+        {intern("false"), TokenType::False},
+        {intern("null"), TokenType::Null},
+        {intern("if"), TokenType::If},
+        {intern("elif"), TokenType::Elif},
+        {intern("else"), TokenType::Else},
+        {intern("for"), TokenType::For},
+        {intern("in"), TokenType::In},
+        {intern("while"), TokenType::While},
+        {intern("end"), TokenType::End},
+        {intern("break"), TokenType::Break},
+        {intern("continue"), TokenType::Continue},
+        {intern("throw"), TokenType::Throw},
+        {intern("try"), TokenType::Try},
+        {intern("catch"), TokenType::Catch},
+        {intern("finally"), TokenType::Finally},
+        {intern("fun"), TokenType::Fun},
+        {intern("return"), TokenType::Return},
+        {intern("class"), TokenType::Class},
+        {intern("lambda"), TokenType::Lambda},
+        {intern("import"), TokenType::Import},
     };
 }
 
@@ -297,7 +303,7 @@ void Scanner::read_identifier()
         ++m_offset;
     }
 
-    string t = m_data.substr(m_start, m_curr - m_start);
+    Symbol t = intern(m_data.substr(m_start, m_curr - m_start));
 
     auto p = keywords.find(t);
 
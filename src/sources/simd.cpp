@@ -0,0 +1,373 @@
+#include "simd.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(HALO_NO_SIMD)
+#define HALO_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t lanes = 4;
+
+    unsigned long long wrap(long long v)
+    {
+        return static_cast<unsigned long long>(v);
+    }
+
+    // the scalar kernels keep the lanes of the vector ones
+
+    template <typename T, typename Op>
+    T reduce_scalar(const T *a, size_t n, T init, Op op)
+    {
+        T acc[lanes] = {init, init, init, init};
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            for (size_t j = 0; j < lanes; ++j)
+            {
+                acc[j] = op(acc[j], a[i + j]);
+            }
+        }
+
+        T res = op(op(acc[0], acc[1]), op(acc[2], acc[3]));
+
+        for (; i < n; ++i)
+        {
+            res = op(res, a[i]);
+        }
+
+        return res;
+    }
+
+    double dot_scalar(const double *a, const double *b, size_t n)
+    {
+        double acc[lanes] = {};
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            for (size_t j = 0; j < lanes; ++j)
+            {
+                acc[j] += a[i + j] * b[i + j];
+            }
+        }
+
+        double res = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+
+        for (; i < n; ++i)
+        {
+            res += a[i] * b[i];
+        }
+
+        return res;
+    }
+
+    auto add_int = [](long long x, long long y)
+    { return static_cast<long long>(wrap(x) + wrap(y)); };
+    auto add_float = [](double x, double y)
+    { return x + y; };
+    // the same operand order as _mm256_min_pd(y, x) and _mm256_max_pd(y, x)
+    auto min_op = [](auto x, auto y)
+    { return y < x ? y : x; };
+    auto max_op = [](auto x, auto y)
+    { return y > x ? y : x; };
+
+#ifdef HALO_AVX2
+    bool has_avx2()
+    {
+        static const bool res = __builtin_cpu_supports("avx2");
+        return res;
+    }
+
+    __attribute__((target("avx2"))) long long hsum(__m256i v)
+    {
+        alignas(32) long long l[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(l), v);
+        return static_cast<long long>((wrap(l[0]) + wrap(l[1])) + (wrap(l[2]) + wrap(l[3])));
+    }
+
+    __attribute__((target("avx2"))) double hsum(__m256d v)
+    {
+        alignas(32) double l[lanes];
+        _mm256_store_pd(l, v);
+        return (l[0] + l[1]) + (l[2] + l[3]);
+    }
+
+    __attribute__((target("avx2"))) long long sum_avx2(const long long *a, size_t n)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            acc = _mm256_add_epi64(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)));
+        }
+
+        long long res = hsum(acc);
+
+        for (; i < n; ++i)
+        {
+            res = add_int(res, a[i]);
+        }
+
+        return res;
+    }
+
+    __attribute__((target("avx2"))) double sum_avx2(const double *a, size_t n)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+        }
+
+        double res = hsum(acc);
+
+        for (; i < n; ++i)
+        {
+            res += a[i];
+        }
+
+        return res;
+    }
+
+    // AVX2 has no 64-bit integer min and max, so they compare and blend
+    template <bool Min>
+    __attribute__((target("avx2"))) long long min_max_avx2(const long long *a, size_t n)
+    {
+        __m256i acc = _mm256_set1_epi64x(a[0]);
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            __m256i take = Min ? _mm256_cmpgt_epi64(acc, v) : _mm256_cmpgt_epi64(v, acc);
+            acc = _mm256_blendv_epi8(acc, v, take);
+        }
+
+        alignas(32) long long l[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(l), acc);
+
+        long long res = l[0];
+
+        for (size_t j = 1; j < lanes; ++j)
+        {
+            res = Min ? min_op(res, l[j]) : max_op(res, l[j]);
+        }
+
+        for (; i < n; ++i)
+        {
+            res = Min ? min_op(res, a[i]) : max_op(res, a[i]);
+        }
+
+        return res;
+    }
+
+    template <bool Min>
+    __attribute__((target("avx2"))) double min_max_avx2(const double *a, size_t n)
+    {
+        __m256d acc = _mm256_set1_pd(a[0]);
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            __m256d v = _mm256_loadu_pd(a + i);
+            acc = Min ? _mm256_min_pd(v, acc) : _mm256_max_pd(v, acc);
+        }
+
+        alignas(32) double l[lanes];
+        _mm256_store_pd(l, acc);
+
+        double res = Min ? min_op(min_op(l[0], l[1]), min_op(l[2], l[3])) : max_op(max_op(l[0], l[1]), max_op(l[2], l[3]));
+
+        for (; i < n; ++i)
+        {
+            res = Min ? min_op(res, a[i]) : max_op(res, a[i]);
+        }
+
+        return res;
+    }
+
+    __attribute__((target("avx2"))) double dot_avx2(const double *a, const double *b, size_t n)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        }
+
+        double res = hsum(acc);
+
+        for (; i < n; ++i)
+        {
+            res += a[i] * b[i];
+        }
+
+        return res;
+    }
+
+    __attribute__((target("avx2"))) void scale_avx2(double *a, size_t n, double k)
+    {
+        __m256d vk = _mm256_set1_pd(k);
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vk));
+        }
+
+        for (; i < n; ++i)
+        {
+            a[i] *= k;
+        }
+    }
+
+    __attribute__((target("avx2"))) void add_avx2(long long *a, const long long *b, size_t n)
+    {
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            auto pa = reinterpret_cast<__m256i *>(a + i);
+            _mm256_storeu_si256(pa, _mm256_add_epi64(_mm256_loadu_si256(pa), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i))));
+        }
+
+        for (; i < n; ++i)
+        {
+            a[i] = add_int(a[i], b[i]);
+        }
+    }
+
+    __attribute__((target("avx2"))) void add_avx2(double *a, const double *b, size_t n)
+    {
+        size_t i = 0;
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            _mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            a[i] += b[i];
+        }
+    }
+#endif
+}
+
+#ifdef HALO_AVX2
+#define HALO_DISPATCH(avx2_call, scalar_call) return has_avx2() ? avx2_call : scalar_call
+#else
+#define HALO_DISPATCH(avx2_call, scalar_call) return scalar_call
+#endif
+
+namespace halo::simd
+{
+    long long sum(const long long *a, size_t n)
+    {
+        HALO_DISPATCH(sum_avx2(a, n), reduce_scalar(a, n, 0LL, add_int));
+    }
+
+    double sum(const double *a, size_t n)
+    {
+        HALO_DISPATCH(sum_avx2(a, n), reduce_scalar(a, n, 0.0, add_float));
+    }
+
+    long long min(const long long *a, size_t n)
+    {
+        HALO_DISPATCH(min_max_avx2<true>(a, n), reduce_scalar(a, n, a[0], min_op));
+    }
+
+    double min(const double *a, size_t n)
+    {
+        HALO_DISPATCH(min_max_avx2<true>(a, n), reduce_scalar(a, n, a[0], min_op));
+    }
+
+    long long max(const long long *a, size_t n)
+    {
+        HALO_DISPATCH(min_max_avx2<false>(a, n), reduce_scalar(a, n, a[0], max_op));
+    }
+
+    double max(const double *a, size_t n)
+    {
+        HALO_DISPATCH(min_max_avx2<false>(a, n), reduce_scalar(a, n, a[0], max_op));
+    }
+
+    // AVX2 has no 64-bit integer multiplication
+    long long dot(const long long *a, const long long *b, size_t n)
+    {
+        unsigned long long res = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            res += wrap(a[i]) * wrap(b[i]);
+        }
+
+        return static_cast<long long>(res);
+    }
+
+    double dot(const double *a, const double *b, size_t n)
+    {
+        HALO_DISPATCH(dot_avx2(a, b, n), dot_scalar(a, b, n));
+    }
+
+    void scale(long long *a, size_t n, long long k)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = static_cast<long long>(wrap(a[i]) * wrap(k));
+        }
+    }
+
+    void scale(double *a, size_t n, double k)
+    {
+#ifdef HALO_AVX2
+        if (has_avx2())
+        {
+            scale_avx2(a, n, k);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] *= k;
+        }
+    }
+
+    void add(long long *a, const long long *b, size_t n)
+    {
+#ifdef HALO_AVX2
+        if (has_avx2())
+        {
+            add_avx2(a, b, n);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = add_int(a[i], b[i]);
+        }
+    }
+
+    void add(double *a, const double *b, size_t n)
+    {
+#ifdef HALO_AVX2
+        if (has_avx2())
+        {
+            add_avx2(a, b, n);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] += b[i];
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+// the kernels of IntArray and FloatArray: on x86-64 processors with AVX2 they process
+// four elements per instruction, elsewhere, or when built with HALO_NO_SIMD, they fall back to scalar loops
+//
+// a float reduction is summed in four lanes by both versions, element i into lane i % 4,
+// so its result does not depend on the version that computed it
+namespace halo::simd
+{
+    // the int kernels wrap around on overflow
+    long long sum(const long long *a, size_t n);
+    double sum(const double *a, size_t n);
+
+    // n must not be 0
+    long long min(const long long *a, size_t n);
+    double min(const double *a, size_t n);
+    long long max(const long long *a, size_t n);
+    double max(const double *a, size_t n);
+
+    long long dot(const long long *a, const long long *b, size_t n);
+    double dot(const double *a, const double *b, size_t n);
+
+    // a[i] *= k
+    void scale(long long *a, size_t n, long long k);
+    void scale(double *a, size_t n, double k);
+
+    // a[i] += b[i]
+    void add(long long *a, const long long *b, size_t n);
+    void add(double *a, const double *b, size_t n);
+}
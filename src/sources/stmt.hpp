@@ -29,6 +29,7 @@ namespace halo
     {
         Token m_token;
         Expr *m_expr;
+        Location m_loc;
 
         VarStmt(Token t, Expr *e, size_t line)
             : Stmt(line), m_token(t), m_expr(e)
@@ -42,6 +43,8 @@ namespace halo
     {
         Expr *m_lval;
         Expr *m_expr;
+        // of a field assignment
+        FieldCache m_cache;
 
         AssignmentStmt(Expr *lv, Expr *e, size_t line)
             : Stmt(line), m_lval(lv), m_expr(e)
@@ -68,6 +71,8 @@ namespace halo
         std::vector<Expr *> m_conds;
         std::vector<std::vector<std::unique_ptr<Stmt>>> m_then_branches;
         std::vector<std::unique_ptr<Stmt>> m_else_branch;
+        std::vector<size_t> m_then_sizes;
+        size_t m_else_size = 0;
 
         IfStmt(std::vector<Expr *> conds, std::vector<std::vector<std::unique_ptr<Stmt>>> then_branches, std::vector<std::unique_ptr<Stmt>> else_branch, size_t line)
             : Stmt(line), m_conds(conds), m_then_branches(std::move(then_branches)), m_else_branch(std::move(else_branch))
@@ -81,6 +86,7 @@ namespace halo
     {
         Expr *m_cond;
         std::vector<std::unique_ptr<Stmt>> m_do_branch;
+        size_t m_do_size = 0;
 
         WhileStmt(Expr *cond, std::vector<std::unique_ptr<Stmt>> do_branch, size_t line)
             : Stmt(line), m_cond(cond), m_do_branch(std::move(do_branch))
@@ -99,6 +105,13 @@ namespace halo
         Expr *m_iterable;
         std::vector<std::unique_ptr<Stmt>> m_do_branch;
 
+        // the header scope keeps the iterable and its iterator in its first slots, and the loop variable
+        // when the body declares no variables and so gets no scope of its own; the bounds of a range
+        // are kept outside of the environment, so a range loop has either a header scope or a body scope
+        size_t m_header_size = 0;
+        size_t m_do_size = 0;
+        Location m_loc;
+
         ForStmt(Token identifier, Expr *begin, Expr *end, Expr *step, Expr *iterable, std::vector<std::unique_ptr<Stmt>> do_branch, size_t line)
             : Stmt(line), m_identifier(identifier), m_begin(begin), m_end(end), m_step(step), m_iterable(iterable), m_do_branch(std::move(do_branch))
         {
@@ -133,6 +146,10 @@ namespace halo
         std::vector<Token> m_params;
         std::vector<std::unique_ptr<Stmt>> m_body;
 
+        // methods keep 'my' in the first slot of their scope
+        std::vector<size_t> m_param_slots;
+        size_t m_scope_size = 0;
+
         FunStmt(Token name, const std::vector<Token> &params, std::vector<std::unique_ptr<Stmt>> body, size_t line)
             : Stmt(line), m_name(name), m_params(params), m_body(std::move(body))
         {
@@ -158,9 +175,11 @@ namespace halo
         Token m_name;
         std::set<std::string> m_fields;
         std::vector<std::unique_ptr<FunStmt>> m_methods;
+        // of the instances of every class made from this statement
+        Shape m_shape;
 
         ClassStmt(Token name, const std::set<std::string> &fields, std::vector<std::unique_ptr<FunStmt>> methods, size_t line)
-            : Stmt(line), m_name(name), m_fields(fields), m_methods(std::move(methods))
+            : Stmt(line), m_name(name), m_fields(fields), m_methods(std::move(methods)), m_shape({fields.begin(), fields.end()})
         {
         }
 
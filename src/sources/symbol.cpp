@@ -0,0 +1,15 @@
+#include "symbol.hpp"
+
+#include <unordered_set>
+
+using namespace std;
+using namespace halo;
+
+Symbol halo::intern(const std::string &name)
+{
+    // a node-based set, so the strings never move; a function-local static,
+    // so the builtin method tables can intern their names during static initialization
+    static unordered_set<string> symbols;
+
+    return &*symbols.insert(name).first;
+}
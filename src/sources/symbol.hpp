@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace halo
+{
+    // an interned name: equal names are the same string, so symbols are compared and hashed
+    // by address; the scanner interns every lexeme, and symbols live until the program ends
+    using Symbol = const std::string *;
+
+    Symbol intern(const std::string &name);
+}
@@ -3,6 +3,7 @@
 #include <ostream>
 #include <string>
 
+#include "symbol.hpp"
 #include "token_type.hpp"
 
 namespace halo
@@ -10,13 +11,24 @@ namespace halo
     struct Token
     {
         const TokenType m_type;
-        const std::string m_lexeme;
+        // the interned lexeme, see symbol()
+        const std::string &m_lexeme;
         const size_t m_line;
         const size_t m_offset;
 
         Token(TokenType type, const std::string &lexeme, size_t line, size_t offset)
-            : m_type(type), m_lexeme(lexeme), m_line(line), m_offset(offset)
+            : m_type(type), m_lexeme(*intern(lexeme)), m_line(line), m_offset(offset)
         {
         }
+
+        Token(TokenType type, Symbol lexeme, size_t line, size_t offset)
+            : m_type(type), m_lexeme(*lexeme), m_line(line), m_offset(offset)
+        {
+        }
+
+        Symbol symbol() const
+        {
+            return &m_lexeme;
+        }
     };
 }
\ No newline at end of file
@@ -33,6 +33,8 @@ namespace halo
         ClosePar,
         OpenBracket,
         CloseBracket,
+        OpenBrace,
+        CloseBrace,
         Identifier,
         Not,
         And,
@@ -0,0 +1,629 @@
+#include "vm.hpp"
+#include "compiler.hpp"
+#include "gc.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace halo;
+
+namespace
+{
+    const Token add_token(TokenType::Plus, "+", 0, 0);
+    const Token subtract_token(TokenType::Minus, "-", 0, 0);
+    const Token multiply_token(TokenType::Mul, "*", 0, 0);
+    const Token divide_token(TokenType::Div, "/", 0, 0);
+    const Token modulo_token(TokenType::Mod, "%", 0, 0);
+    const Token less_token(TokenType::Less, "<", 0, 0);
+    const Token less_equal_token(TokenType::LessEqual, "<=", 0, 0);
+    const Token greater_token(TokenType::Greater, ">", 0, 0);
+    const Token greater_equal_token(TokenType::GreaterEqual, ">=", 0, 0);
+    const Token equal_token(TokenType::EqualEqual, "==", 0, 0);
+    const Token not_equal_token(TokenType::BangEqual, "!=", 0, 0);
+    const Token not_token(TokenType::Not, "not", 0, 0);
+    const Token negate_token(TokenType::Minus, "-", 0, 0);
+
+    const Token for_iterable_token(TokenType::Var, "__for_iterable__", 0, 0);
+    const Token for_it_token(TokenType::Var, "__for_it__", 0, 0);
+}
+
+VM::VM(Interpreter &interp)
+    : m_interp(interp)
+{
+    m_interp.m_vm = this;
+}
+
+VM::~VM()
+{
+    m_interp.m_vm = nullptr;
+}
+
+void VM::execute(const std::vector<std::unique_ptr<Stmt>> &stmts)
+{
+    Compiler compiler(m_chunks, m_interp.m_counters != nullptr);
+    run(compiler.compile(stmts));
+}
+
+Value VM::evaluate(Expr *e)
+{
+    Compiler compiler(m_chunks, m_interp.m_counters != nullptr);
+    return run(compiler.compile(e));
+}
+
+Value VM::run(Chunk *chunk)
+{
+    Frame frame{chunk, 0, 0};
+    FrameManager fm(this, &frame);
+
+    size_t stack_size = m_stack.size();
+    size_t scope_count = m_interp.m_env.m_scopes.size();
+    size_t tmp_count = m_interp.m_tmp_vals.size();
+
+    try
+    {
+        Value res = dispatch(frame);
+        unwind(stack_size, scope_count, tmp_count);
+        return res;
+    }
+    catch (const std::exception &)
+    {
+        unwind(stack_size, scope_count, tmp_count);
+
+        // any error inside a for-in loop is reported as an invalid iterator by the outermost loop
+
+        const Chunk::IterRegion *region = nullptr;
+
+        for (const auto &r : chunk->m_iter_regions)
+        {
+            if (r.m_begin <= frame.m_op && frame.m_op < r.m_end && (!region || r.m_begin < region->m_begin))
+            {
+                region = &r;
+            }
+        }
+
+        if (!region)
+        {
+            throw;
+        }
+
+        frame.m_op = region->m_handler;
+        throw runtime_error(m_interp.report_error("invalid iterator"));
+    }
+}
+
+void VM::unwind(size_t stack_size, size_t scope_count, size_t tmp_count)
+{
+    m_stack.resize(stack_size);
+
+    while (m_interp.m_env.m_scopes.size() > scope_count)
+    {
+        m_interp.m_env.remove_scope();
+    }
+
+    m_interp.clear_tmp_stack_from(tmp_count);
+}
+
+Value VM::dispatch(Frame &frame)
+{
+    Chunk *chunk = frame.m_chunk;
+    const uint8_t *code = chunk->m_code.data();
+    size_t ip = 0;
+
+    auto read_u8 = [&]()
+    {
+        return code[ip++];
+    };
+
+    auto read_u16 = [&]()
+    {
+        size_t hi = code[ip++];
+        size_t lo = code[ip++];
+        return (hi << 8) | lo;
+    };
+
+    auto binary = [&](const Token &op)
+    {
+        // operands stay on the stack while the result is allocated
+        Value res = m_interp.binary_op(op, peek(1), peek(0));
+        m_stack.pop_back();
+        m_stack.back() = res;
+    };
+
+    for (;;)
+    {
+        frame.m_op = ip;
+
+        if (Profiler::pending())
+        {
+            m_interp.take_sample(false);
+        }
+
+        switch (static_cast<OpCode>(read_u8()))
+        {
+        case OpCode::Constant:
+            m_stack.push_back(chunk->m_constants[read_u16()]);
+            break;
+        case OpCode::Null:
+            m_stack.push_back(nullptr);
+            break;
+        case OpCode::Pop:
+            m_stack.pop_back();
+            break;
+        case OpCode::GetGlobal:
+            m_stack.push_back(m_interp.m_env.get(chunk->m_names[read_u16()], Location()));
+            break;
+        case OpCode::DefineGlobal:
+            m_interp.m_env.define(chunk->m_names[read_u16()], peek());
+            m_stack.pop_back();
+            break;
+        case OpCode::AssignGlobal:
+            m_interp.m_env.assign(chunk->m_names[read_u16()], peek(), Location());
+            m_stack.pop_back();
+            break;
+        case OpCode::GetLocal:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            Location loc;
+            loc.m_depth = read_u8();
+            loc.m_slot = read_u16();
+            m_stack.push_back(m_interp.m_env.get(name, loc));
+            break;
+        }
+        case OpCode::DefineLocal:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            m_interp.m_env.define(name, peek(), Location{0, read_u16()});
+            m_stack.pop_back();
+            break;
+        }
+        case OpCode::StoreLocal:
+            m_interp.m_env.store(Location{0, read_u16()}, peek());
+            m_stack.pop_back();
+            break;
+        case OpCode::AssignLocal:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            Location loc;
+            loc.m_depth = read_u8();
+            loc.m_slot = read_u16();
+            m_interp.m_env.assign(name, peek(), loc);
+            m_stack.pop_back();
+            break;
+        }
+        case OpCode::GetField:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            get_field(name, chunk->m_field_caches[read_u16()]);
+            break;
+        }
+        case OpCode::SetField:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            set_field(name, chunk->m_field_caches[read_u16()]);
+            break;
+        }
+        case OpCode::GetIndex:
+        {
+            Value res = as_indexable(peek(1))->get(peek());
+
+            m_stack.pop_back();
+            m_stack.back() = res;
+            break;
+        }
+        case OpCode::SetIndex:
+            as_indexable(peek(2))->set(peek(1), peek());
+            m_stack.resize(m_stack.size() - 3);
+            break;
+        case OpCode::JumpIfNotIndexable:
+        {
+            size_t offset = read_u16();
+
+            if (!as_indexable(peek()))
+            {
+                ip += offset;
+            }
+            break;
+        }
+        case OpCode::Add:
+            binary(add_token);
+            break;
+        case OpCode::Subtract:
+            binary(subtract_token);
+            break;
+        case OpCode::Multiply:
+            binary(multiply_token);
+            break;
+        case OpCode::Divide:
+            binary(divide_token);
+            break;
+        case OpCode::Modulo:
+            binary(modulo_token);
+            break;
+        case OpCode::Less:
+            binary(less_token);
+            break;
+        case OpCode::LessEqual:
+            binary(less_equal_token);
+            break;
+        case OpCode::Greater:
+            binary(greater_token);
+            break;
+        case OpCode::GreaterEqual:
+            binary(greater_equal_token);
+            break;
+        case OpCode::Equal:
+            binary(equal_token);
+            break;
+        case OpCode::NotEqual:
+            binary(not_equal_token);
+            break;
+        case OpCode::Not:
+            m_stack.back() = m_interp.unary_op(not_token, peek());
+            break;
+        case OpCode::Negate:
+            m_stack.back() = m_interp.unary_op(negate_token, peek());
+            break;
+        case OpCode::Jump:
+        {
+            size_t offset = read_u16();
+            ip += offset;
+            break;
+        }
+        case OpCode::JumpIfFalse:
+        {
+            size_t offset = read_u16();
+
+            if (!Interpreter::is_true(pop()))
+            {
+                ip += offset;
+            }
+            break;
+        }
+        case OpCode::JumpIfTrueOrPop:
+        {
+            size_t offset = read_u16();
+
+            if (Interpreter::is_true(peek()))
+            {
+                ip += offset;
+            }
+            else
+            {
+                m_stack.pop_back();
+            }
+            break;
+        }
+        case OpCode::JumpIfFalseOrPop:
+        {
+            size_t offset = read_u16();
+
+            if (!Interpreter::is_true(peek()))
+            {
+                ip += offset;
+            }
+            else
+            {
+                m_stack.pop_back();
+            }
+            break;
+        }
+        case OpCode::Loop:
+        {
+            size_t offset = read_u16();
+            ip -= offset;
+            break;
+        }
+        case OpCode::CheckNull:
+            if (peek().is_null())
+            {
+                null_error(static_cast<NullCheck>(code[ip]));
+            }
+            ++ip;
+            break;
+        case OpCode::PrepareCall:
+            prepare_call(read_u8());
+            break;
+        case OpCode::Call:
+        {
+            size_t argc = read_u8();
+            call(argc, chunk->m_calls[read_u16()].m_line);
+            break;
+        }
+        case OpCode::Invoke:
+        {
+            const Token &name = chunk->m_names[read_u16()];
+            size_t argc = read_u8();
+            invoke(name, argc, chunk->m_calls[read_u16()]);
+            break;
+        }
+        case OpCode::MakeList:
+            make_list(read_u16());
+            break;
+        case OpCode::MakeDict:
+            make_dict(read_u16());
+            break;
+        case OpCode::MakeSet:
+            make_set(read_u16());
+            break;
+        case OpCode::MakeLambda:
+        {
+            const auto &proto = chunk->m_lambdas[read_u16()];
+            m_stack.push_back(m_interp.make_lambda(proto.m_l, proto.m_chunk));
+            break;
+        }
+        case OpCode::DefFun:
+        {
+            const auto &proto = chunk->m_funs[read_u16()];
+            m_interp.define_function(proto.m_fst, proto.m_chunk);
+            break;
+        }
+        case OpCode::DefClass:
+        {
+            const auto &proto = chunk->m_classes[read_u16()];
+            m_interp.define_class(proto.m_cst, proto.m_methods);
+            break;
+        }
+        case OpCode::EnterScope:
+        {
+            auto st = static_cast<Environment::ScopeType>(read_u8());
+            m_interp.m_env.add_scope(st, read_u16());
+            break;
+        }
+        case OpCode::ExitScope:
+            for (size_t count = read_u8(); count > 0; --count)
+            {
+                m_interp.m_env.remove_scope();
+            }
+            break;
+        case OpCode::Return:
+            return pop();
+        case OpCode::RangeInit:
+            range_init();
+            break;
+        case OpCode::RangeNext:
+        {
+            size_t offset = read_u16();
+
+            Value &left = peek(1);
+
+            if (left.m_int == 0)
+            {
+                ip += offset;
+                break;
+            }
+
+            left.m_int = static_cast<unsigned long long>(left.m_int) - 1;
+            m_stack.push_back(Value::integer(peek().m_int));
+            break;
+        }
+        case OpCode::RangeStep:
+            peek().m_int = static_cast<unsigned long long>(peek().m_int) + peek(2).m_int;
+            break;
+        case OpCode::IterInit:
+            iter_init();
+            break;
+        case OpCode::IterNext:
+        {
+            size_t offset = read_u16();
+
+            Value it = peek();
+
+            if (!m_interp.iter_has_next(it))
+            {
+                ip += offset;
+                break;
+            }
+
+            m_stack.push_back(m_interp.iter_next(it));
+            break;
+        }
+        case OpCode::Error:
+            error(static_cast<String *>(chunk->m_constants[read_u16()].m_obj));
+        case OpCode::CountLine:
+            m_interp.m_counters->count_line(chunk->m_constants[read_u16()].m_int);
+            break;
+        }
+    }
+}
+
+void VM::get_field(const Token &name, FieldCache &cache)
+{
+    m_stack.back() = m_interp.field_owner(peek(), name.m_lexeme)->get_field(name.symbol(), cache);
+}
+
+void VM::set_field(const Token &name, FieldCache &cache)
+{
+    m_interp.field_owner(peek(1), name.m_lexeme)->set_field(name.symbol(), peek(), cache);
+    m_stack.resize(m_stack.size() - 2);
+}
+
+void VM::null_error(NullCheck check)
+{
+    switch (check)
+    {
+    case NullCheck::Call:
+        throw runtime_error(m_interp.report_error("attempt to perform a call on null"));
+    case NullCheck::RangeBegin:
+        throw runtime_error(m_interp.report_error("first index in range cannot be null"));
+    case NullCheck::RangeEnd:
+        throw runtime_error(m_interp.report_error("last index in range cannot be null"));
+    case NullCheck::RangeStep:
+        throw runtime_error(m_interp.report_error("step in range cannot be null"));
+    }
+
+    throw runtime_error(m_interp.report_error("unknown null check"));
+}
+
+void VM::prepare_call(size_t argc)
+{
+    Value v = peek();
+
+    m_interp.check_null(v, "attempt to perform a call on null");
+
+    Callable *c = as_callable(v);
+
+    if (!c)
+    {
+        throw runtime_error(m_interp.report_error("'" + v.to_str() + "' is not a function or lambda"));
+    }
+
+    if (c->arity() != int(argc))
+    {
+        throw runtime_error(m_interp.report_error("incorrect number of arguments for '" + c->to_str() + "'"));
+    }
+}
+
+void VM::call(size_t argc, size_t line)
+{
+    size_t callee = m_stack.size() - argc - 1;
+    Callable *c = as_callable(m_stack[callee]);
+    vector<Value> args(m_stack.begin() + callee + 1, m_stack.end());
+    size_t tmp_count = m_interp.m_tmp_vals.size();
+
+    Value res;
+
+    {
+        Interpreter::ContextManager cm(&m_interp, line, NodeKind::CallExpr, c);
+
+        res = c->call(args);
+    }
+
+    m_stack.resize(callee);
+    m_stack.push_back(res);
+    m_interp.clear_tmp_stack_from(tmp_count);
+}
+
+void VM::invoke(const Token &name, size_t argc, Chunk::CallSite &site)
+{
+    size_t receiver = m_stack.size() - argc - 1;
+    Object *o = m_interp.method_owner(m_stack[receiver], name.m_lexeme);
+    vector<Value> args(m_stack.begin() + receiver + 1, m_stack.end());
+    size_t tmp_count = m_interp.m_tmp_vals.size();
+
+    o->m_type->resolve_method(name.symbol(), args, site.m_method_cache);
+
+    Value res;
+
+    {
+        Interpreter::ContextManager cm(&m_interp, site.m_line, NodeKind::CallExpr, o, name.symbol());
+
+        res = o->m_type->call_cached(o, site.m_method_cache, args);
+    }
+
+    m_stack.resize(receiver);
+    m_stack.push_back(res);
+    m_interp.clear_tmp_stack_from(tmp_count);
+}
+
+void VM::make_list(size_t count)
+{
+    Object *o = GC::instance().new_object(ObjectType::List);
+    static_cast<List *>(o)->m_vals.assign(m_stack.end() - count, m_stack.end());
+
+    m_stack.resize(m_stack.size() - count);
+    m_stack.push_back(o);
+}
+
+void VM::make_dict(size_t count)
+{
+    // the pairs stay on the stack until the dict is filled, a key of the wrong type throws
+    Object *o = GC::instance().new_object(ObjectType::Dict);
+    m_stack.push_back(o);
+
+    for (size_t i = m_stack.size() - 1 - 2 * count; i < m_stack.size() - 1; i += 2)
+    {
+        static_cast<Dict *>(o)->set(m_stack[i], m_stack[i + 1]);
+    }
+
+    m_stack.resize(m_stack.size() - 1 - 2 * count);
+    m_stack.push_back(o);
+}
+
+void VM::make_set(size_t count)
+{
+    Object *o = GC::instance().new_object(ObjectType::Set);
+    m_stack.push_back(o);
+
+    for (size_t i = m_stack.size() - 1 - count; i < m_stack.size() - 1; ++i)
+    {
+        static_cast<Set *>(o)->add(m_stack[i]);
+    }
+
+    m_stack.resize(m_stack.size() - 1 - count);
+    m_stack.push_back(o);
+}
+
+void VM::range_init()
+{
+    // [begin, end, step] -> [step, iterations left, counter]
+
+    if (peek(2).m_tag != ObjectType::Int)
+    {
+        throw runtime_error(m_interp.report_error("first index in range must be an integer"));
+    }
+    if (peek(1).m_tag != ObjectType::Int)
+    {
+        throw runtime_error(m_interp.report_error("last index in range must be an integer"));
+    }
+    if (peek().m_tag != ObjectType::Int)
+    {
+        throw runtime_error(m_interp.report_error("step in range must be an integer"));
+    }
+
+    if (peek().m_int == 0)
+    {
+        throw runtime_error(m_interp.report_error("step in range must not be 0"));
+    }
+
+    long long begin = peek(2).m_int;
+    long long left = Range::length(begin, peek(1).m_int, peek().m_int);
+
+    peek(2) = peek();
+    peek(1) = Value::integer(left);
+    peek() = Value::integer(begin);
+}
+
+void VM::iter_init()
+{
+    // [iterable] -> [iterable, iterator]
+
+    Value it = m_interp.iter_init(peek());
+    m_stack.push_back(it);
+
+    m_interp.m_env.define(for_iterable_token, peek(1), Location{0, 0});
+    m_interp.m_env.define(for_it_token, it, Location{0, 1});
+
+    try
+    {
+        m_interp.iter_check(it);
+    }
+    catch (const std::exception &)
+    {
+        throw runtime_error(m_interp.report_error("invalid iterator"));
+    }
+}
+
+void VM::error(String *desc)
+{
+    throw runtime_error(m_interp.report_error(desc->to_str()));
+}
+
+void VM::sync_debug_info()
+{
+    for (auto frame : m_frames)
+    {
+        const Chunk::DebugEntry *entry = frame->m_chunk->debug_entry(frame->m_op);
+
+        frame->m_context->m_line = entry ? entry->m_line : 0;
+        frame->m_context->m_kind = entry ? entry->m_kind : NodeKind::None;
+    }
+}
+
+void VM::mark()
+{
+    for (auto &v : m_stack)
+    {
+        v.mark();
+    }
+}
\ No newline at end of file
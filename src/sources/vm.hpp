@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "chunk.hpp"
+#include "interpreter.hpp"
+
+namespace halo
+{
+    class VM
+    {
+        struct Frame
+        {
+            Chunk *m_chunk;
+            size_t m_op;
+            // filled from the debug table of the chunk by sync_debug_info()
+            Interpreter::Context *m_context;
+        };
+
+        struct FrameManager
+        {
+            VM *m_vm;
+            Interpreter::ContextManager m_cm;
+
+            FrameManager(VM *vm, Frame *frame)
+                : m_vm(vm), m_cm(&vm->m_interp, 0, NodeKind::None)
+            {
+                frame->m_context = &m_cm.m_context;
+                m_vm->m_frames.push_back(frame);
+            }
+
+            ~FrameManager()
+            {
+                m_vm->m_frames.pop_back();
+            }
+        };
+
+        Interpreter &m_interp;
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+        std::vector<Value> m_stack;
+        std::vector<Frame *> m_frames;
+
+        Value dispatch(Frame &frame);
+
+        // the less frequent and heavier instructions are kept out of the dispatch loop to keep its frame small
+
+        void get_field(const Token &name, FieldCache &cache);
+        void set_field(const Token &name, FieldCache &cache);
+        [[noreturn]] void null_error(NullCheck check);
+        void prepare_call(size_t argc);
+        void call(size_t argc, size_t line);
+        void invoke(const Token &name, size_t argc, Chunk::CallSite &site);
+        void make_list(size_t count);
+        void make_dict(size_t count);
+        void make_set(size_t count);
+        void range_init();
+        void iter_init();
+        [[noreturn]] void error(String *desc);
+
+        Value pop()
+        {
+            Value v = m_stack.back();
+            m_stack.pop_back();
+            return v;
+        }
+
+        Value &peek(size_t distance = 0)
+        {
+            return m_stack[m_stack.size() - 1 - distance];
+        }
+
+        void unwind(size_t stack_size, size_t scope_count, size_t tmp_count);
+
+    public:
+        VM(Interpreter &interp);
+        ~VM();
+
+        void execute(const std::vector<std::unique_ptr<Stmt>> &stmts);
+        Value evaluate(Expr *e);
+
+        Value run(Chunk *chunk);
+
+        void sync_debug_info();
+        void mark();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "workers.hpp"
+
+using namespace halo;
+using namespace std;
+
+void Workers::work(size_t id, size_t generation)
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_start.wait(lock, [&]
+                     { return m_stop || m_generation != generation; });
+
+        if (m_stop)
+        {
+            return;
+        }
+
+        generation = m_generation;
+        const function<void(size_t)> &job = *m_job;
+
+        lock.unlock();
+        job(id);
+        lock.lock();
+
+        if (--m_running == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void Workers::resize(size_t count)
+{
+    if (count == m_threads.size())
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_start.notify_all();
+
+    for (auto &t : m_threads)
+    {
+        t.join();
+    }
+
+    m_threads.clear();
+    m_stop = false;
+
+    // the ids start at 1, job(0) runs on the thread that calls run()
+    for (size_t i = 1; i <= count; ++i)
+    {
+        m_threads.emplace_back(&Workers::work, this, i, m_generation);
+    }
+}
+
+void Workers::run(const function<void(size_t)> &job)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_job = &job;
+        m_running = m_threads.size();
+        ++m_generation;
+    }
+
+    m_start.notify_all();
+
+    job(0);
+
+    unique_lock<mutex> lock(m_mutex);
+    m_done.wait(lock, [this]
+                { return m_running == 0; });
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace halo
+{
+    // threads that are started once and then wait to run the jobs given to run(),
+    // so the GC marks and sweeps in parallel without starting a thread per collection
+    class Workers
+    {
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_start;
+        std::condition_variable m_done;
+        const std::function<void(size_t)> *m_job = nullptr;
+        // counts the jobs run so far, so a thread runs each of them once
+        size_t m_generation = 0;
+        // the threads still running the current job
+        size_t m_running = 0;
+        bool m_stop = false;
+
+        void work(size_t id, size_t generation);
+
+    public:
+        Workers() = default;
+        Workers(const Workers &) = delete;
+        Workers &operator=(const Workers &) = delete;
+
+        ~Workers()
+        {
+            resize(0);
+        }
+
+        size_t size() const
+        {
+            return m_threads.size();
+        }
+
+        // keeps count threads, it must not be called while a job runs
+        void resize(size_t count);
+
+        // runs job(0), ..., job(size()), job(0) on the calling thread, and waits for all of them
+        void run(const std::function<void(size_t)> &job);
+    };
+}
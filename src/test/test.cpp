@@ -7,6 +7,9 @@
 #include "../sources/parser.hpp"
 #include "../sources/interpreter.hpp"
 #include "../sources/printer.hpp"
+#include "../sources/vm.hpp"
+#include "../sources/profiler.hpp"
+#include "../sources/counters.hpp"
 
 #include <fstream>
 
@@ -133,6 +136,25 @@ TEST_CASE("Scanner::read_one_symbol_lexeme")
         REQUIRE(res[1].m_line == 2);
         REQUIRE(res[1].m_offset == 0);
     }
+
+    SUBCASE("OpenBrace && CloseBrace")
+    {
+        string s = "{\n}";
+        Scanner scanner(s);
+        auto res = scanner.scan();
+
+        REQUIRE(res.size() == 3);
+
+        REQUIRE(res[0].m_type == TokenType::OpenBrace);
+        REQUIRE(res[0].m_lexeme == "{");
+        REQUIRE(res[0].m_line == 1);
+        REQUIRE(res[0].m_offset == 0);
+
+        REQUIRE(res[1].m_type == TokenType::CloseBrace);
+        REQUIRE(res[1].m_lexeme == "}");
+        REQUIRE(res[1].m_line == 2);
+        REQUIRE(res[1].m_offset == 0);
+    }
 }
 
 TEST_CASE("Scanner::read_two_symbol_lexeme")
@@ -723,8 +745,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "4");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "4");
     }
 
     SUBCASE("Hello+World")
@@ -736,8 +758,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "HelloWorld");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "HelloWorld");
     }
 
     SUBCASE("--4")
@@ -749,8 +771,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "4");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "4");
     }
 
     SUBCASE("not true")
@@ -762,8 +784,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("2 + 2.0")
@@ -775,8 +797,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "4.000000");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "4.000000");
     }
 
     SUBCASE("2.0 + 2")
@@ -788,8 +810,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "4.000000");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "4.000000");
     }
 
     SUBCASE("2 + hello")
@@ -814,8 +836,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "6");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "6");
     }
 
     SUBCASE("20 % 3")
@@ -827,8 +849,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "2");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "2");
     }
 
     SUBCASE("\n20.0 % 3.0")
@@ -853,8 +875,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("3 < 2")
@@ -866,8 +888,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("3.0 < 2.0")
@@ -879,8 +901,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("3.0 < 2")
@@ -892,8 +914,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("3.0 <= 3")
@@ -905,8 +927,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("3 > 3")
@@ -918,8 +940,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("3 >= 3")
@@ -931,8 +953,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("3 == 3")
@@ -944,8 +966,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("3 == 2")
@@ -957,8 +979,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("3.0 == 2.0")
@@ -970,8 +992,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("hello == hello")
@@ -983,8 +1005,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("true == true")
@@ -996,8 +1018,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("true != true")
@@ -1009,8 +1031,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("1 < 5 or 5 < 10")
@@ -1022,8 +1044,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("1 < 5 and 5 < 10")
@@ -1035,8 +1057,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("1 > 5 or 5 < 10")
@@ -1048,8 +1070,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "true");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "true");
     }
 
     SUBCASE("1 > 5 and 5 < 10")
@@ -1061,8 +1083,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("true and false")
@@ -1074,8 +1096,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "false");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
     }
 
     SUBCASE("0 and 1")
@@ -1087,8 +1109,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "0");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "0");
     }
 
     SUBCASE("\"\" and \"\"")
@@ -1100,8 +1122,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "");
     }
 
     SUBCASE("0.0 or 1")
@@ -1113,8 +1135,8 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o->to_str() == "1");
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "1");
     }
 
     SUBCASE("true and null")
@@ -1126,8 +1148,33 @@ TEST_CASE("expr interpreter")
         Expr *e = p.parse_expr();
 
         Interpreter interpreter;
-        Object *o = interpreter.evaluate(e);
-        REQUIRE(o == nullptr);
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.is_null());
+    }
+
+    SUBCASE("null == 2")
+    {
+        string s = "null == 2";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+        Expr *e = p.parse_expr();
+
+        Interpreter interpreter;
+        Value o = interpreter.evaluate(e);
+        REQUIRE(o.to_str() == "false");
+    }
+
+    SUBCASE("20 % 0")
+    {
+        string s = "20 % 0";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+        Expr *e = p.parse_expr();
+
+        Interpreter interpreter;
+        REQUIRE_THROWS_AS(interpreter.evaluate(e), runtime_error);
     }
 }
 
@@ -1271,6 +1318,60 @@ TEST_CASE("list")
     }
 }
 
+TEST_CASE("dict")
+{
+    Printer ep;
+
+    SUBCASE("{\"a\": 1 + 2, b: [c]}")
+    {
+        string s = "{\"a\": 1 + 2, b: [c]}";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+        Expr *e = p.parse_expr();
+
+        e->visit(&ep);
+
+        REQUIRE(ep.m_data.str() == "{a: (1+2), b: [c]}");
+    }
+
+    SUBCASE("{   }")
+    {
+        string s = "{   }";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+        Expr *e = p.parse_expr();
+
+        e->visit(&ep);
+
+        REQUIRE(ep.m_data.str() == "{}");
+    }
+
+    SUBCASE("{1, a, {2}}")
+    {
+        string s = "{1, a, {2}}";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+        Expr *e = p.parse_expr();
+
+        e->visit(&ep);
+
+        REQUIRE(ep.m_data.str() == "{1, a, {2}}");
+    }
+
+    SUBCASE("{1: 2, 3}")
+    {
+        string s = "{1: 2, 3}";
+        Scanner sc(s);
+        auto v = sc.scan();
+        Parser p(v);
+
+        REQUIRE_THROWS_AS(p.parse_expr(), runtime_error);
+    }
+}
+
 TEST_CASE("scripts")
 {
     /* NATIVE FUN */
@@ -1401,6 +1502,170 @@ TEST_CASE("scripts")
         REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
     }
 
+    SUBCASE("native_fun/008")
+    {
+        ifstream file("scripts/native_fun/008.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "4\n4498500\n");
+    }
+
+    SUBCASE("native_fun/009")
+    {
+        ifstream file("scripts/native_fun/009.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+    }
+
+    SUBCASE("native_fun/010")
+    {
+        ifstream file("scripts/native_fun/010.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "3.000000\n500\ntrue\n7\ntrue\n2.000000\n");
+    }
+
+    SUBCASE("native_fun/011")
+    {
+        ifstream file("scripts/native_fun/011.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+    }
+
+    SUBCASE("native_fun/012")
+    {
+        ifstream file("scripts/native_fun/012.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "cdx\ncdy\ncdz\nfalse\ntrue\n81\n28\nn=81, [1.500000, true, null]\nn=81, [1.500000, true, null]!\n");
+    }
+
+    SUBCASE("native_fun/013")
+    {
+        ifstream file("scripts/native_fun/013.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "01234567890123456789\n567890123456\ntrue\n56789!\n56789?\n56789\n2\n563\n");
+    }
+
+    SUBCASE("native_fun/014")
+    {
+        ifstream file("scripts/native_fun/014.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "[39, -7, 12, 222]\n[6, -13, 26, 13, 4, 23, 2, 23, 16, 11, 22]\n[5, 11.250000, -2.250000, 8.000000]\n[true, 0.000000, 8.000000]\nempty\n");
+    }
+
+    SUBCASE("native_fun/015")
+    {
+        ifstream file("scripts/native_fun/015.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "range(0, 10, 3)\n4\n6\n[0, 3, 6, 9]\n55\n18\n0\nempty\ntrue\nfalse\n0\n3\n6\n9\n[1, 2, 3, 10, 20, 30]\na\nb\nc\nrange(-9223372036854775807, 9223372036854775807, 4611686018427387904)\n-9223372036854775807\n-4611686018427387903\n1\n4611686018427387905\n");
+    }
+
+    SUBCASE("native_fun/016")
+    {
+        ifstream file("scripts/native_fun/016.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "9223372036854775807\n9223372036854775807\n");
+    }
+
     /* CONTROL STMT */
 
     SUBCASE("control_stmt/001")
@@ -1708,11 +1973,9 @@ TEST_CASE("scripts")
         REQUIRE(s_out.str() == "1\n2\n4\n5\n");
     }
 
-    /* FUN */
-
-    SUBCASE("fun/001")
+    SUBCASE("control_stmt/019")
     {
-        ifstream file("scripts/fun/001.halo");
+        ifstream file("scripts/control_stmt/019.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
@@ -1725,30 +1988,30 @@ TEST_CASE("scripts")
         Interpreter interp(s_in, s_out);
         interp.execute(p.statements());
 
-        REQUIRE(s_out.str() == "hello, world\n");
+        REQUIRE(s_out.str() == "2\n-1\n25\n3\nnull\n");
     }
 
-    SUBCASE("fun/002")
+    SUBCASE("control_stmt/020")
     {
-        ifstream file("scripts/fun/002.halo");
+        ifstream file("scripts/control_stmt/020.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
         Parser p(v);
         p.parse();
 
-        istringstream s_in("Johnson");
+        istringstream s_in("");
         ostringstream s_out;
 
         Interpreter interp(s_in, s_out);
-        interp.execute(p.statements());
 
-        REQUIRE(s_out.str() == "hello, Johnson\nnull\n");
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "1\n100\n3\n0\n10\n20\n2\n6\n2\n");
     }
 
-    SUBCASE("fun/003")
+    SUBCASE("control_stmt/021")
     {
-        ifstream file("scripts/fun/003.halo");
+        ifstream file("scripts/control_stmt/021.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
@@ -1761,12 +2024,14 @@ TEST_CASE("scripts")
         Interpreter interp(s_in, s_out);
         interp.execute(p.statements());
 
-        REQUIRE(s_out.str() == "6\n");
+        REQUIRE(s_out.str() == "0\n3\n6\n9\n10\n7\n4\n1\n9223372036854775800\n9223372036854775804\n-9223372036854775807\n-9223372036854775802\n12\n16\n");
     }
 
-    SUBCASE("fun/004")
+    /* FUN */
+
+    SUBCASE("fun/001")
     {
-        ifstream file("scripts/fun/004.halo");
+        ifstream file("scripts/fun/001.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
@@ -1779,36 +2044,90 @@ TEST_CASE("scripts")
         Interpreter interp(s_in, s_out);
         interp.execute(p.statements());
 
-        REQUIRE(s_out.str() == "1\n2\n3\n4\n");
+        REQUIRE(s_out.str() == "hello, world\n");
     }
 
-    SUBCASE("fun/005")
+    SUBCASE("fun/002")
     {
-        ifstream file("scripts/fun/005.halo");
+        ifstream file("scripts/fun/002.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
         Parser p(v);
         p.parse();
 
-        istringstream s_in("");
+        istringstream s_in("Johnson");
         ostringstream s_out;
 
         Interpreter interp(s_in, s_out);
         interp.execute(p.statements());
 
-        REQUIRE(s_out.str() == "6\n1\n1\n");
+        REQUIRE(s_out.str() == "hello, Johnson\nnull\n");
     }
 
-    SUBCASE("fun/006")
+    SUBCASE("fun/003")
     {
-        ifstream file("scripts/fun/006.halo");
+        ifstream file("scripts/fun/003.halo");
         string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
         Scanner sc(src);
         auto v = sc.scan();
         Parser p(v);
+        p.parse();
 
-        REQUIRE_THROWS_AS_MESSAGE(p.parse(), runtime_error, "Parse error\n    line 1: <return statement> out of function");
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "6\n");
+    }
+
+    SUBCASE("fun/004")
+    {
+        ifstream file("scripts/fun/004.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "1\n2\n3\n4\n");
+    }
+
+    SUBCASE("fun/005")
+    {
+        ifstream file("scripts/fun/005.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "6\n1\n1\n");
+    }
+
+    SUBCASE("fun/006")
+    {
+        ifstream file("scripts/fun/006.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+
+        REQUIRE_THROWS_AS_MESSAGE(p.parse(), runtime_error, "Parse error\n    line 1: <return statement> out of function");
     }
 
     SUBCASE("fun/007")
@@ -1892,6 +2211,24 @@ TEST_CASE("scripts")
         REQUIRE_THROWS_AS_MESSAGE(interp.execute(p.statements()), runtime_error, "Execution error\nline 2: name 'x' is not found");
     }
 
+    SUBCASE("fun/012")
+    {
+        ifstream file("scripts/fun/012.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "1\n0\n1\n6\n1\n");
+    }
+
     /* LAMBDA */
 
     SUBCASE("lambda/001")
@@ -2223,6 +2560,24 @@ TEST_CASE("scripts")
         REQUIRE(s_out.str() == "Point[x=3, y=4]\nPoint[x=3, y=3]\n<class Point>:\nvar x\n    y\nfun _init_\n    move\n");
     }
 
+    SUBCASE("class/012")
+    {
+        ifstream file("scripts/class/012.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "3 4 5 6 7 8 \nD[x=6, y=null, z=null]\nnull\n");
+    }
+
     /* CALL */
 
     SUBCASE("call/001")
@@ -2407,6 +2762,24 @@ TEST_CASE("scripts")
         REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
     }
 
+    SUBCASE("call/011")
+    {
+        ifstream file("scripts/call/011.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "3\n7\n0\n8\n1\n");
+    }
+
     /* LIST */
 
     SUBCASE("list/001")
@@ -2616,6 +2989,157 @@ TEST_CASE("scripts")
         REQUIRE(s_out.str() == "[1, 3]\n");
     }
 
+    SUBCASE("list/012")
+    {
+        ifstream file("scripts/list/012.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "[1, null, 2.500000, a, null]\n[1, 2.500000, a]\ntrue\nfalse\n");
+    }
+
+    SUBCASE("list/013")
+    {
+        ifstream file("scripts/list/013.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "[0!, 42, 2!]\n");
+    }
+
+    SUBCASE("list/014")
+    {
+        ifstream file("scripts/list/014.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "1\n");
+    }
+
+    /* DICT */
+
+    SUBCASE("dict/001")
+    {
+        ifstream file("scripts/dict/001.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "3\n5\ntrue\n-1\ntrue\nfalse\n{a: 10, 3: three, true: [1, 2], c: 42}\na 3 true c \n[a, 3, true, c]\n[10, three, [1, 2], 42]\ntrue\nfalse\n");
+    }
+
+    SUBCASE("dict/002")
+    {
+        ifstream file("scripts/dict/002.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "{1, 2, 3}\ntrue\nfalse\n4\ntrue\ntrue\n[m, i, s, p]\n");
+    }
+
+    SUBCASE("dict/003")
+    {
+        ifstream file("scripts/dict/003.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+    }
+
+    SUBCASE("dict/004")
+    {
+        ifstream file("scripts/dict/004.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        interp.execute(p.statements());
+
+        REQUIRE(s_out.str() == "2\ntrue\n1\n1\ntrue\n1\n2\n2\n");
+    }
+
+    SUBCASE("dict/005")
+    {
+        ifstream file("scripts/dict/005.halo");
+        string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+
+        REQUIRE_THROWS_AS(interp.execute(p.statements()), runtime_error);
+        REQUIRE(s_out.str() == "true\ntrue\n");
+    }
+
     /* ERR */
 
     SUBCASE("err/001")
@@ -2640,3 +3164,224 @@ TEST_CASE("scripts")
 #ifdef asafasfaf
 #endif
 }
+
+string run_script(const string &path, const string &input, bool use_vm)
+{
+    ifstream file(path);
+    string src = string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    istringstream s_in(input);
+    ostringstream s_out;
+
+    try
+    {
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        Interpreter interp(s_in, s_out);
+        unique_ptr<VM> vm = use_vm ? make_unique<VM>(interp) : nullptr;
+
+        if (vm)
+        {
+            vm->execute(p.statements());
+        }
+        else
+        {
+            interp.execute(p.statements());
+        }
+    }
+    catch (const exception &e)
+    {
+        s_out << "\n"
+              << e.what();
+    }
+
+    return s_out.str();
+}
+
+TEST_CASE("vm")
+{
+    vector<pair<string, string>> scripts = {{"native_fun/002", "Kamila"}, {"control_stmt/001", "21"}, {"fun/002", "Johnson"}};
+
+    for (auto [dir, count] : vector<pair<string, int>>{{"call", 11}, {"class", 12}, {"control_stmt", 21}, {"dict", 5}, {"err", 1}, {"fun", 12}, {"lambda", 8}, {"list", 15}, {"native_fun", 16}})
+    {
+        for (int i = 1; i <= count; ++i)
+        {
+            string name = dir + (i < 10 ? "/00" : "/0") + to_string(i);
+
+            if (find_if(scripts.begin(), scripts.end(), [&](const auto &s)
+                        { return s.first == name; }) == scripts.end())
+            {
+                scripts.emplace_back(name, "");
+            }
+        }
+    }
+
+    for (const auto &[name, input] : scripts)
+    {
+        CAPTURE(name);
+
+        string path = "scripts/" + name + ".halo";
+
+        REQUIRE(run_script(path, input, true) == run_script(path, input, false));
+    }
+}
+
+// a long list is marked a slice at a time, elements removed from it before the slice reached
+// them must not make the marking skip the ones moved into their place
+TEST_CASE("gc list slices")
+{
+    GC &gc = GC::instance();
+    size_t nursery_size = gc.get_nursery_size();
+    size_t heap_size = gc.get_treshold();
+    size_t step_budget = gc.get_step_budget();
+    double growth = gc.get_growth();
+
+    gc.set_nursery_size(16);
+    gc.set_heap_size(10);
+    gc.set_step_budget(64);
+    gc.set_growth(1);
+
+    string interp_out = run_script("scripts/list/015.halo", "", false);
+    string vm_out = run_script("scripts/list/015.halo", "", true);
+
+    gc.set_nursery_size(nursery_size);
+    gc.set_heap_size(heap_size);
+    gc.set_step_budget(step_budget);
+    gc.set_growth(growth);
+
+    REQUIRE(interp_out == "true\n2050\n1t2t49u\n");
+    REQUIRE(vm_out == interp_out);
+}
+
+TEST_CASE("profiler")
+{
+    Profiler profiler;
+
+    profiler.add_sample({{"script", 7}, {"fun f", 2}});
+    profiler.add_sample({{"script", 7}, {"fun f", 2}});
+    profiler.add_sample({{"script", 7}, {"fun f", 3}, {"fun f", 2}});
+    profiler.add_sample({{"script", 9}});
+
+    SUBCASE("folded stacks")
+    {
+        ostringstream out;
+        profiler.report_folded(out);
+
+        REQUIRE(out.str() == "script:7;fun f:2 2\nscript:7;fun f:3;fun f:2 1\nscript:9 1\n");
+    }
+
+    SUBCASE("top functions and lines")
+    {
+        ostringstream out;
+        profiler.report_top(out, 2);
+
+        REQUIRE(out.str() == "Profile: 4 samples, one every 1000 us of CPU time\n"
+                             "\n   self ms  self %  total ms  total %  function\n"
+                             "       3.0    75.0       3.0     75.0  fun f\n"
+                             "       1.0    25.0       4.0    100.0  script\n"
+                             "\n   self ms  self %  total ms  total %  line\n"
+                             "       3.0    75.0       3.0     75.0  fun f:2\n"
+                             "       1.0    25.0       1.0     25.0  script:9\n");
+    }
+
+    SUBCASE("sampled script")
+    {
+        string src = "fun f(n):\n    var s = 0;\n    for i in (0, n):\n        let s = s + i;\n    end\n    return s;\nend\nprintln(f(200000));";
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        Profiler sampler(100);
+        interp.set_profiler(&sampler);
+        sampler.start();
+        interp.execute(p.statements());
+        sampler.stop();
+
+        ostringstream folded;
+        sampler.report_folded(folded);
+
+        REQUIRE(s_out.str() == "19999900000\n");
+
+        istringstream lines(folded.str());
+
+        for (string line; getline(lines, line);)
+        {
+            REQUIRE(line.rfind("script:", 0) == 0);
+        }
+    }
+}
+
+TEST_CASE("counters")
+{
+    string src = "fun f(n):\n    var s = [];\n    for i in (0, n):\n        s.put(to_str(i));\n    end\n    return s;\nend\nvar g = lambda[](x): return x; end;\nif g(1) > 2:\n    println(\"never\");\nend\nprintln(f(3));";
+
+    string json = "{\n"
+                  "  \"script\": \"test.halo\",\n"
+                  "  \"lines\": [\n"
+                  "    {\"line\": 1, \"hits\": 1, \"allocations\": 1},\n"
+                  "    {\"line\": 2, \"hits\": 1, \"allocations\": 1},\n"
+                  "    {\"line\": 3, \"hits\": 1, \"allocations\": 0},\n"
+                  "    {\"line\": 4, \"hits\": 3, \"allocations\": 3},\n"
+                  "    {\"line\": 6, \"hits\": 1, \"allocations\": 0},\n"
+                  "    {\"line\": 8, \"hits\": 2, \"allocations\": 1},\n"
+                  "    {\"line\": 9, \"hits\": 1, \"allocations\": 0},\n"
+                  "    {\"line\": 10, \"hits\": 0, \"allocations\": 0},\n"
+                  "    {\"line\": 12, \"hits\": 1, \"allocations\": 0}\n"
+                  "  ],\n"
+                  "  \"functions\": [\n"
+                  "    {\"name\": \"fun f\", \"line\": 1, \"calls\": 1},\n"
+                  "    {\"name\": \"lambda\", \"line\": 8, \"calls\": 1}\n"
+                  "  ]\n"
+                  "}\n";
+
+    for (bool use_vm : {false, true})
+    {
+        CAPTURE(use_vm);
+
+        Scanner sc(src);
+        auto v = sc.scan();
+        Parser p(v);
+        p.parse();
+
+        istringstream s_in("");
+        ostringstream s_out;
+
+        Interpreter interp(s_in, s_out);
+        Counters counters("test.halo");
+        counters.add_program(p.statements());
+        interp.set_counters(&counters);
+
+        if (use_vm)
+        {
+            VM vm(interp);
+            vm.execute(p.statements());
+        }
+        else
+        {
+            interp.execute(p.statements());
+        }
+
+        interp.set_counters(nullptr);
+
+        REQUIRE(s_out.str() == "[0, 1, 2]\n");
+
+        ostringstream out;
+        counters.report_json(out);
+
+        REQUIRE(out.str() == json);
+
+        ostringstream lcov;
+        counters.report_lcov(lcov);
+
+        REQUIRE(lcov.str() == "TN:\nSF:test.halo\nFN:1,fun f:1\nFN:8,lambda:8\nFNDA:1,fun f:1\nFNDA:1,lambda:8\nFNF:2\nFNH:2\n"
+                              "DA:1,1\nDA:2,1\nDA:3,1\nDA:4,3\nDA:6,1\nDA:8,2\nDA:9,1\nDA:10,0\nDA:12,1\nLF:9\nLH:8\nend_of_record\n");
+    }
+}